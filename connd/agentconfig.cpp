@@ -0,0 +1,246 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+
+#include "agentconfig.h"
+#include "tracing.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QScopedPointer>
+#include <QSettings>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+// values read back from the file are strings, compare them as such
+static bool sameValue(const QVariant &a, const QVariant &b)
+{
+    if (a.userType() == b.userType())
+        return a == b;
+    return a.toString() == b.toString();
+}
+
+AgentConfig::AgentConfig(const QString &group, const QString &fileName, QObject *parent) :
+    QThread(parent),
+    group(group),
+    settingsFile(fileName),
+    watcher(nullptr),
+    writing(false),
+    stopping(false),
+    writeCount(0)
+{
+    settleTimer.setSingleShot(true);
+    settleTimer.setInterval(500);
+    connect(&settleTimer, &QTimer::timeout, this, &AgentConfig::settled);
+
+    writeTimer.setSingleShot(true);
+    writeTimer.setInterval(2000);
+    connect(&writeTimer, &QTimer::timeout, this, &AgentConfig::writeBehind);
+}
+
+AgentConfig::~AgentConfig()
+{
+    flush();
+
+    {
+        QMutexLocker locker(&mutex);
+        stopping = true;
+        wake.wakeOne();
+    }
+    wait();
+}
+
+QSettings *AgentConfig::openSettings() const
+{
+    if (settingsFile.isEmpty())
+        return new QSettings;
+    return new QSettings(settingsFile, QSettings::IniFormat);
+}
+
+void AgentConfig::setWriteDelay(int msecs)
+{
+    writeTimer.setInterval(msecs);
+}
+
+bool AgentConfig::contains(const QString &key) const
+{
+    return values.contains(key);
+}
+
+QVariant AgentConfig::value(const QString &key, const QVariant &defaultValue) const
+{
+    return values.value(key, defaultValue);
+}
+
+void AgentConfig::setValue(const QString &key, const QVariant &value)
+{
+    QVariantHash::const_iterator it = values.constFind(key);
+    if (it != values.constEnd() && *it == value)
+        return;
+
+    values.insert(key, value);
+    pending.insert(key, value);
+    if (!writeTimer.isActive())
+        writeTimer.start();
+}
+
+void AgentConfig::remove(const QString &key)
+{
+    if (!values.remove(key))
+        return;
+
+    pending.insert(key, QVariant());
+    if (!writeTimer.isActive())
+        writeTimer.start();
+}
+
+void AgentConfig::flush()
+{
+    writeTimer.stop();
+    writeBehind();
+
+    QMutexLocker locker(&mutex);
+    while (!queued.isEmpty() || writing)
+        written.wait(&mutex);
+}
+
+quint32 AgentConfig::writes() const
+{
+    QMutexLocker locker(&mutex);
+    return writeCount;
+}
+
+void AgentConfig::load()
+{
+    reload();
+}
+
+void AgentConfig::watch()
+{
+    if (watcher)
+        return;
+
+    // QSettings replaces the file on sync, so watch the directory too
+    watcher = new QFileSystemWatcher(this);
+    watcher->addPath(QFileInfo(fileName).absolutePath());
+    if (QFile::exists(fileName))
+        watcher->addPath(fileName);
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, &AgentConfig::fileChanged);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &AgentConfig::fileChanged);
+}
+
+bool AgentConfig::reload()
+{
+    QVariantHash fresh;
+    QScopedPointer<QSettings> settings(openSettings());
+    fileName = settings->fileName();
+    settings->beginGroup(group);
+    for (const QString &key : settings->childKeys())
+        fresh.insert(key, settings->value(key));
+
+    // what has not reached the file yet still stands, including what is
+    // being written right now
+    QVariantHash unwritten;
+    {
+        QMutexLocker locker(&mutex);
+        unwritten = inFlight;
+        for (QVariantHash::const_iterator it = queued.constBegin(); it != queued.constEnd(); ++it)
+            unwritten.insert(it.key(), it.value());
+    }
+    for (QVariantHash::const_iterator it = pending.constBegin(); it != pending.constEnd(); ++it)
+        unwritten.insert(it.key(), it.value());
+    for (QVariantHash::const_iterator it = unwritten.constBegin(); it != unwritten.constEnd(); ++it) {
+        if (it.value().isValid())
+            fresh.insert(it.key(), it.value());
+        else
+            fresh.remove(it.key());
+    }
+
+    bool different = fresh.count() != values.count();
+    for (QVariantHash::const_iterator it = fresh.constBegin(); !different && it != fresh.constEnd(); ++it)
+        different = !values.contains(it.key()) || !sameValue(values.value(it.key()), it.value());
+
+    values = fresh;
+    return different;
+}
+
+void AgentConfig::fileChanged()
+{
+    if (!watcher->files().contains(fileName) && QFile::exists(fileName))
+        watcher->addPath(fileName);
+    settleTimer.start();
+}
+
+void AgentConfig::settled()
+{
+    TRACE_FUNCTION();
+    if (reload()) {
+        qCInfo(connAgent) << "Settings changed in" << fileName;
+        Q_EMIT changed();
+    }
+}
+
+void AgentConfig::writeBehind()
+{
+    if (pending.isEmpty())
+        return;
+
+    if (!isRunning())
+        start(QThread::LowPriority);
+
+    QMutexLocker locker(&mutex);
+    for (QVariantHash::const_iterator it = pending.constBegin(); it != pending.constEnd(); ++it)
+        queued.insert(it.key(), it.value());
+    pending.clear();
+    wake.wakeOne();
+}
+
+void AgentConfig::run()
+{
+    QMutexLocker locker(&mutex);
+    forever {
+        while (queued.isEmpty() && !stopping)
+            wake.wait(&mutex);
+        if (queued.isEmpty() && stopping)
+            break;
+
+        QVariantHash batch;
+        batch.swap(queued);
+        inFlight = batch;
+        writing = true;
+        locker.unlock();
+
+        QScopedPointer<QSettings> settings(openSettings());
+        settings->beginGroup(group);
+        for (QVariantHash::const_iterator it = batch.constBegin(); it != batch.constEnd(); ++it) {
+            if (it.value().isValid())
+                settings->setValue(it.key(), it.value());
+            else
+                settings->remove(it.key());
+        }
+        settings->sync();
+        if (settings->status() != QSettings::NoError)
+            qCWarning(connAgent) << "Cannot write settings to" << settings->fileName();
+
+        locker.relock();
+        inFlight.clear();
+        writing = false;
+        writeCount++;
+        written.wakeAll();
+    }
+}
@@ -0,0 +1,105 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+
+#ifndef AGENTCONFIG_H
+#define AGENTCONFIG_H
+
+#include <QThread>
+#include <QHash>
+#include <QMutex>
+#include <QTimer>
+#include <QVariant>
+#include <QWaitCondition>
+
+/*
+ * The agent's settings group, read once by load() and kept in memory; the
+ * constructor does not touch the disk. Reads never touch the disk either;
+ * changes take effect in memory at once and are written back by a worker
+ * thread after a short delay, so a burst of changes costs one write and a
+ * slow flash never holds up the main loop. flush() blocks until everything
+ * is on disk and is called at shutdown.
+ *
+ * When watched, edits made to the file by others are picked up and
+ * changed() is emitted; changes not yet written here are kept.
+ *
+ * The application's settings file is used unless a file name is given.
+ *
+ * The object lives in the main thread, only run() does not.
+ */
+class QFileSystemWatcher;
+class QSettings;
+
+class AgentConfig : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit AgentConfig(const QString &group, const QString &fileName = QString(), QObject *parent = 0);
+    ~AgentConfig();
+
+    void setWriteDelay(int msecs);
+
+    bool contains(const QString &key) const;
+    QVariant value(const QString &key, const QVariant &defaultValue = QVariant()) const;
+    void setValue(const QString &key, const QVariant &value);
+    void remove(const QString &key);
+
+    void flush();
+    quint32 writes() const;
+
+    void load();
+    // Needs load() first for the file name
+    void watch();
+    // Rereads the file, returns whether anything changed
+    bool reload();
+
+Q_SIGNALS:
+    void changed();
+
+protected:
+    void run() override;
+
+private slots:
+    void writeBehind();
+    void fileChanged();
+    void settled();
+
+private:
+    QSettings *openSettings() const;
+
+    QString group;
+    // empty for the application's settings
+    QString settingsFile;
+    QString fileName;
+    QFileSystemWatcher *watcher;
+    QTimer settleTimer;
+    QVariantHash values;
+    // changed keys not yet handed to the writer, an invalid value removes the key
+    QVariantHash pending;
+    QTimer writeTimer;
+
+    mutable QMutex mutex;
+    QWaitCondition wake;
+    QWaitCondition written;
+    QVariantHash queued;
+    // the batch the writer is busy with
+    QVariantHash inFlight;
+    bool writing;
+    bool stopping;
+    quint32 writeCount;
+};
+
+#endif // AGENTCONFIG_H
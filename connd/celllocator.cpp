@@ -0,0 +1,138 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "celllocator.h"
+#include "tracing.h"
+
+#include <QDBusArgument>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusObjectPath>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+#define OFONO_SERVICE "org.ofono"
+#define OFONO_REGISTRATION "org.ofono.NetworkRegistration"
+
+CellLocator::CellLocator(QObject *parent) :
+    QObject(parent)
+{
+}
+
+CellLocator::~CellLocator()
+{
+}
+
+void CellLocator::watchOfono()
+{
+    QDBusConnection bus = QDBusConnection::systemBus();
+    bus.connect(OFONO_SERVICE, QString(), OFONO_REGISTRATION, QStringLiteral("PropertyChanged"),
+                this, SLOT(registrationPropertyChanged(QString,QDBusVariant)));
+
+    QDBusMessage call = QDBusMessage::createMethodCall(OFONO_SERVICE, QStringLiteral("/"),
+                                                       QStringLiteral("org.ofono.Manager"),
+                                                       QStringLiteral("GetModems"));
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(bus.asyncCall(call), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, &CellLocator::modemsReceived);
+}
+
+QString CellLocator::cell() const
+{
+    return currentCell;
+}
+
+void CellLocator::setCell(const QString &key)
+{
+    TRACE_FUNCTION();
+    if (currentCell == key)
+        return;
+
+    qCDebug(connAgent) << "Serving cell" << key;
+    currentCell = key;
+    Q_EMIT cellChanged(key);
+}
+
+void CellLocator::modemsReceived(QDBusPendingCallWatcher *call)
+{
+    TRACE_FUNCTION();
+    call->deleteLater();
+    QDBusPendingReply<> reply = *call;
+    if (reply.isError()) {
+        qCDebug(connAgent) << "oFono not available:" << reply.error().message();
+        return;
+    }
+
+    // a(oa{sv})
+    const QDBusArgument modems = reply.reply().arguments().value(0).value<QDBusArgument>();
+    modems.beginArray();
+    while (!modems.atEnd()) {
+        QDBusObjectPath path;
+        QVariantMap properties;
+        modems.beginStructure();
+        modems >> path >> properties;
+        modems.endStructure();
+
+        QDBusMessage getProperties = QDBusMessage::createMethodCall(OFONO_SERVICE, path.path(),
+                                                                    OFONO_REGISTRATION,
+                                                                    QStringLiteral("GetProperties"));
+        QDBusPendingCallWatcher *watcher =
+                new QDBusPendingCallWatcher(QDBusConnection::systemBus().asyncCall(getProperties), this);
+        watcher->setProperty("modem", path.path());
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, &CellLocator::registrationReceived);
+    }
+    modems.endArray();
+}
+
+void CellLocator::registrationReceived(QDBusPendingCallWatcher *call)
+{
+    TRACE_FUNCTION();
+    call->deleteLater();
+    QDBusPendingReply<QVariantMap> reply = *call;
+    if (reply.isError())
+        return;
+
+    updateModem(call->property("modem").toString(), reply.value());
+}
+
+void CellLocator::registrationPropertyChanged(const QString &name, const QDBusVariant &value)
+{
+    TRACE_FUNCTION();
+    QVariantMap change;
+    change.insert(name, value.variant());
+    updateModem(message().path(), change);
+}
+
+void CellLocator::updateModem(const QString &path, const QVariantMap &properties)
+{
+    QVariantMap &registration = registrations[path];
+    for (QVariantMap::const_iterator it = properties.constBegin(); it != properties.constEnd(); ++it)
+        registration.insert(it.key(), it.value());
+
+    if (registration.value(QStringLiteral("Status")).toString() != QLatin1String("registered")
+            && registration.value(QStringLiteral("Status")).toString() != QLatin1String("roaming")) {
+        return;
+    }
+    if (!registration.contains(QStringLiteral("CellId")))
+        return;
+
+    setCell(QStringLiteral("%1-%2-%3-%4")
+            .arg(registration.value(QStringLiteral("MobileCountryCode")).toString())
+            .arg(registration.value(QStringLiteral("MobileNetworkCode")).toString())
+            .arg(registration.value(QStringLiteral("LocationAreaCode")).toUInt())
+            .arg(registration.value(QStringLiteral("CellId")).toUInt()));
+}
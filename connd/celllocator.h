@@ -0,0 +1,62 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef CELLLOCATOR_H
+#define CELLLOCATOR_H
+
+#include <QObject>
+#include <QDBusContext>
+#include <QDBusVariant>
+#include <QHash>
+#include <QVariantMap>
+
+class QDBusPendingCallWatcher;
+
+/*
+ * Follows the serving cell of the modems through oFono's
+ * NetworkRegistration interface and reports it as a single
+ * "mcc-mnc-lac-cellid" key. setCell() lets another source, or a test,
+ * feed the key directly.
+ */
+class CellLocator : public QObject, protected QDBusContext
+{
+    Q_OBJECT
+
+public:
+    explicit CellLocator(QObject *parent = 0);
+    ~CellLocator();
+
+    void watchOfono();
+    QString cell() const;
+
+public slots:
+    void setCell(const QString &key);
+
+Q_SIGNALS:
+    void cellChanged(const QString &key);
+
+private slots:
+    void modemsReceived(QDBusPendingCallWatcher *call);
+    void registrationReceived(QDBusPendingCallWatcher *call);
+    void registrationPropertyChanged(const QString &name, const QDBusVariant &value);
+
+private:
+    void updateModem(const QString &path, const QVariantMap &properties);
+
+    QString currentCell;
+    QHash<QString, QVariantMap> registrations;
+};
+
+#endif // CELLLOCATOR_H
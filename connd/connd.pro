@@ -3,13 +3,21 @@ QT = core network dbus
 TARGET = connectionagent
 PKGCONFIG += connman-qt5
 
-packagesExist(qt5-boostable) {
+# the booster hands over a preinitialised QGuiApplication, so booster
+# support links QtGui into the daemon; CONFIG+=noboost leaves both out
+noboost {
+    message("booster support disabled")
+} else:packagesExist(qt5-boostable) {
     DEFINES += HAS_BOOSTER
     PKGCONFIG += qt5-boostable
+    QT += gui
 } else {
     warning("qt5-boostable not available; startup times will be slower")
 }
 
+# CONFIG+=notracing compiles the trace spans out
+notracing: DEFINES += CONNECTIONAGENT_NO_TRACING
+
 CONFIG   += console link_pkgconfig
 CONFIG   -= app_bundle
 
@@ -23,10 +31,62 @@ connadaptor.header_flags = -c ConnAdaptor
 connadaptor.source_flags = -c ConnAdaptor
 
 SOURCES += main.cpp \
-    qconnectionagent.cpp
+    qconnectionagent.cpp \
+    tetheringstatemachine.cpp \
+    trafficsampler.cpp \
+    uplinkselector.cpp \
+    migrationengine.cpp \
+    servicehistory.cpp \
+    connectrace.cpp \
+    celllocator.cpp \
+    scanpredictor.cpp \
+    handovercontroller.cpp \
+    qualityprober.cpp \
+    portalcache.cpp \
+    credentialprovider.cpp \
+    retryscheduler.cpp \
+    ethernetpowersave.cpp \
+    sleepwatcher.cpp \
+    metrics.cpp \
+    eventjournal.cpp \
+    tracing.cpp \
+    unixsignalnotifier.cpp \
+    logsink.cpp \
+    lagmonitor.cpp \
+    startuptimings.cpp \
+    warmsnapshot.cpp \
+    agentconfig.cpp \
+    connmanconfig.cpp \
+    idlereclaimer.cpp
 
 HEADERS += \
-    qconnectionagent.h
+    qconnectionagent.h \
+    tetheringstatemachine.h \
+    trafficsampler.h \
+    uplinkselector.h \
+    migrationengine.h \
+    servicehistory.h \
+    connectrace.h \
+    celllocator.h \
+    scanpredictor.h \
+    handovercontroller.h \
+    qualityprober.h \
+    portalcache.h \
+    credentialprovider.h \
+    retryscheduler.h \
+    ethernetpowersave.h \
+    sleepwatcher.h \
+    metrics.h \
+    eventjournal.h \
+    tracing.h \
+    unixsignalnotifier.h \
+    logsink.h \
+    lagmonitor.h \
+    startuptimings.h \
+    warmsnapshot.h \
+    agentconfig.h \
+    connmanconfig.h \
+    idlereclaimer.h
 
 target.path = /usr/bin
 INSTALLS += target
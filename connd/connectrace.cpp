@@ -0,0 +1,201 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "connectrace.h"
+#include "eventjournal.h"
+#include "tracing.h"
+
+#include <connman-qt5/networkservice.h>
+
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+static bool isStateOnline(NetworkService::ServiceState state)
+{
+    return state == NetworkService::OnlineState || state == NetworkService::ReadyState;
+}
+
+ConnectRace::ConnectRace(QObject *parent) :
+    QObject(parent),
+    next(0),
+    concurrency(1)
+{
+    staggerTimer.setInterval(5 * 1000);
+    connect(&staggerTimer, &QTimer::timeout, this, &ConnectRace::launchNext);
+
+    deadline.setSingleShot(true);
+    deadline.setInterval(60 * 1000);
+    connect(&deadline, &QTimer::timeout, this, &ConnectRace::deadlineExpired);
+}
+
+ConnectRace::~ConnectRace()
+{
+}
+
+void ConnectRace::setStagger(int msecs)
+{
+    staggerTimer.setInterval(msecs);
+}
+
+void ConnectRace::setTimeout(int msecs)
+{
+    deadline.setInterval(msecs);
+}
+
+bool ConnectRace::isRunning() const
+{
+    return deadline.isActive();
+}
+
+void ConnectRace::start(const QVector<NetworkService *> &candidates, int maxConcurrent)
+{
+    cancel();
+
+    attempts.clear();
+    attempts.resize(candidates.count());
+    for (int i = 0; i < candidates.count(); ++i) {
+        attempts[i].service = candidates.at(i);
+        connect(candidates.at(i), &NetworkService::serviceStateChanged,
+                this, &ConnectRace::attemptStateChanged);
+    }
+    next = 0;
+    concurrency = qMax(1, maxConcurrent);
+
+    clock.start();
+    deadline.start();
+    staggerTimer.start();
+    launchNext();
+}
+
+void ConnectRace::cancel()
+{
+    if (!isRunning())
+        return;
+
+    for (Attempt &attempt : attempts) {
+        if (attempt.started && !attempt.done)
+            giveUp(attempt, "cancelled");
+    }
+    finish(nullptr);
+}
+
+void ConnectRace::launchNext()
+{
+    TRACE_FUNCTION();
+    if (next >= attempts.count()) {
+        staggerTimer.stop();
+        if (running() == 0)
+            finish(nullptr);
+        return;
+    }
+
+    if (running() >= concurrency) {
+        // make room by giving up on the attempt that has had the longest go
+        for (Attempt &attempt : attempts) {
+            if (attempt.started && !attempt.done) {
+                giveUp(attempt, "too slow");
+                break;
+            }
+        }
+    }
+
+    Attempt &attempt = attempts[next++];
+    if (!attempt.service) {
+        launchNext();
+        return;
+    }
+
+    qCInfo(connAgent) << "Race: connecting" << attempt.service->path() << "at" << clock.elapsed() << "ms";
+    attempt.started = true;
+    attempt.clock.start();
+    EventJournal::request(EventJournal::Connect, attempt.service->path());
+    TRACE_CALL("requestConnect", attempt.service->requestConnect());
+    staggerTimer.start();
+}
+
+void ConnectRace::attemptStateChanged(NetworkService::ServiceState state)
+{
+    TRACE_FUNCTION();
+    NetworkService *service = static_cast<NetworkService *>(sender());
+    if (!isRunning() || !service)
+        return;
+
+    for (Attempt &attempt : attempts) {
+        if (attempt.service != service || !attempt.started || attempt.done)
+            continue;
+
+        if (isStateOnline(state)) {
+            attempt.done = true;
+            qCInfo(connAgent) << "Race:" << service->path() << "won after" << attempt.clock.elapsed() << "ms";
+            for (Attempt &other : attempts) {
+                if (other.started && !other.done)
+                    giveUp(other, "lost");
+            }
+            finish(service);
+        } else if (state == NetworkService::FailureState) {
+            attempt.done = true;
+            qCInfo(connAgent) << "Race:" << service->path() << "failed after" << attempt.clock.elapsed() << "ms";
+            launchNext();
+        }
+        return;
+    }
+}
+
+void ConnectRace::deadlineExpired()
+{
+    TRACE_FUNCTION();
+    qCInfo(connAgent) << "Race: no candidate came up in" << deadline.interval() << "ms";
+    for (Attempt &attempt : attempts) {
+        if (attempt.started && !attempt.done)
+            giveUp(attempt, "timed out");
+    }
+    finish(nullptr);
+}
+
+int ConnectRace::running() const
+{
+    int count = 0;
+    for (const Attempt &attempt : attempts) {
+        if (attempt.started && !attempt.done)
+            ++count;
+    }
+    return count;
+}
+
+void ConnectRace::giveUp(Attempt &attempt, const char *reason)
+{
+    attempt.done = true;
+    if (!attempt.service)
+        return;
+
+    qCInfo(connAgent) << "Race:" << attempt.service->path() << reason
+                      << "after" << attempt.clock.elapsed() << "ms";
+    EventJournal::request(EventJournal::Disconnect, attempt.service->path());
+    TRACE_CALL("requestDisconnect", attempt.service->requestDisconnect());
+}
+
+void ConnectRace::finish(NetworkService *winner)
+{
+    qint64 elapsed = clock.elapsed();
+    staggerTimer.stop();
+    deadline.stop();
+    for (const Attempt &attempt : attempts) {
+        if (attempt.service)
+            attempt.service->disconnect(this);
+    }
+    attempts.clear();
+    Q_EMIT finished(winner, elapsed);
+}
@@ -0,0 +1,80 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef CONNECTRACE_H
+#define CONNECTRACE_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+#include "networkservice.h"
+
+/*
+ * Connects to the first of several candidate services that comes up.
+ * Attempts are started one stagger interval apart, at most maxConcurrent
+ * at a time; when the limit is reached the oldest unfinished attempt is
+ * given up for the next candidate. The first attempt to reach Ready wins
+ * and the others are disconnected.
+ */
+class ConnectRace : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ConnectRace(QObject *parent = 0);
+    ~ConnectRace();
+
+    void setStagger(int msecs);
+    void setTimeout(int msecs);
+
+    bool isRunning() const;
+    void start(const QVector<NetworkService *> &candidates, int maxConcurrent);
+    void cancel();
+
+Q_SIGNALS:
+    // winner is null when no candidate came up
+    void finished(NetworkService *winner, qint64 elapsed);
+
+private slots:
+    void launchNext();
+    void attemptStateChanged(NetworkService::ServiceState state);
+    void deadlineExpired();
+
+private:
+    struct Attempt {
+        Attempt() : started(false), done(false) {}
+
+        QPointer<NetworkService> service;
+        QElapsedTimer clock;
+        bool started;
+        bool done;
+    };
+
+    int running() const;
+    void giveUp(Attempt &attempt, const char *reason);
+    void finish(NetworkService *winner);
+
+    QVector<Attempt> attempts;
+    int next;
+    int concurrency;
+    QElapsedTimer clock;
+    QTimer staggerTimer;
+    QTimer deadline;
+};
+
+#endif // CONNECTRACE_H
@@ -0,0 +1,141 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+
+#include "connmanconfig.h"
+#include "tracing.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+// editors and package updates write in several steps
+static const int SettleTime = 500;
+
+ConnmanConfig::ConnmanConfig(const QString &fileName, QObject *parent) :
+    QObject(parent),
+    fileName(fileName),
+    watcher(nullptr)
+{
+    settleTimer.setSingleShot(true);
+    settleTimer.setInterval(SettleTime);
+    connect(&settleTimer, &QTimer::timeout, this, &ConnmanConfig::reload);
+}
+
+ConnmanConfig::~ConnmanConfig()
+{
+}
+
+bool ConnmanConfig::load()
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        values.clear();
+        return false;
+    }
+    values = parse(file.readAll());
+    return true;
+}
+
+void ConnmanConfig::watch()
+{
+    if (watcher)
+        return;
+
+    // the directory catches the file being replaced or created
+    watcher = new QFileSystemWatcher(this);
+    watcher->addPath(QFileInfo(fileName).absolutePath());
+    if (QFile::exists(fileName))
+        watcher->addPath(fileName);
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, &ConnmanConfig::fileChanged);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &ConnmanConfig::fileChanged);
+}
+
+QStringList ConnmanConfig::defaultAutoConnectTechnologies() const
+{
+    return list("General/DefaultAutoConnectTechnologies");
+}
+
+QStringList ConnmanConfig::preferredTechnologies() const
+{
+    return list("General/PreferredTechnologies");
+}
+
+QStringList ConnmanConfig::alwaysConnectedTechnologies() const
+{
+    return list("General/AlwaysConnectedTechnologies");
+}
+
+QHash<QString, QString> ConnmanConfig::parse(const QByteArray &data)
+{
+    QHash<QString, QString> parsed;
+    QString section;
+    for (const QByteArray &rawLine : data.split('\n')) {
+        const QString line = QString::fromUtf8(rawLine).trimmed();
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#')) || line.startsWith(QLatin1Char(';')))
+            continue;
+
+        if (line.startsWith(QLatin1Char('[')) && line.endsWith(QLatin1Char(']'))) {
+            section = line.mid(1, line.length() - 2).trimmed();
+            continue;
+        }
+
+        const int separator = line.indexOf(QLatin1Char('='));
+        if (separator <= 0 || section.isEmpty())
+            continue;
+        parsed.insert(section + QLatin1Char('/') + line.left(separator).trimmed(),
+                      line.mid(separator + 1).trimmed());
+    }
+    return parsed;
+}
+
+QStringList ConnmanConfig::toList(const QString &value)
+{
+    QStringList items;
+    for (const QString &item : value.split(QLatin1Char(','))) {
+        const QString trimmed = item.trimmed();
+        if (!trimmed.isEmpty())
+            items << trimmed;
+    }
+    return items;
+}
+
+void ConnmanConfig::fileChanged()
+{
+    // a replaced file drops out of the watch list
+    if (!watcher->files().contains(fileName) && QFile::exists(fileName))
+        watcher->addPath(fileName);
+    settleTimer.start();
+}
+
+void ConnmanConfig::reload()
+{
+    TRACE_FUNCTION();
+    const QHash<QString, QString> previous = values;
+    load();
+    if (values == previous)
+        return;
+
+    qCInfo(connAgent) << fileName << "changed";
+    Q_EMIT changed();
+}
+
+QStringList ConnmanConfig::list(const char *key) const
+{
+    return toList(values.value(QString::fromLatin1(key)));
+}
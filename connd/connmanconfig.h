@@ -0,0 +1,69 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+
+#ifndef CONNMANCONFIG_H
+#define CONNMANCONFIG_H
+
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
+
+class QFileSystemWatcher;
+
+/*
+ * The parts of connman's main.conf the agent follows. The file is parsed
+ * as INI the way connman does it (GKeyFile: sections, "Key = Value",
+ * comma separated lists, # comments) and watched; changed() is emitted
+ * once an edit has settled and the contents really changed.
+ */
+class ConnmanConfig : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ConnmanConfig(const QString &fileName = QStringLiteral("/etc/connman/main.conf"),
+                           QObject *parent = 0);
+    ~ConnmanConfig();
+
+    bool load();
+    void watch();
+
+    QStringList defaultAutoConnectTechnologies() const;
+    QStringList preferredTechnologies() const;
+    QStringList alwaysConnectedTechnologies() const;
+
+    // "Section/Key" to value
+    static QHash<QString, QString> parse(const QByteArray &data);
+    static QStringList toList(const QString &value);
+
+Q_SIGNALS:
+    void changed();
+
+private slots:
+    void fileChanged();
+    void reload();
+
+private:
+    QStringList list(const char *key) const;
+
+    QString fileName;
+    QHash<QString, QString> values;
+    QFileSystemWatcher *watcher;
+    QTimer settleTimer;
+};
+
+#endif // CONNMANCONFIG_H
@@ -0,0 +1,181 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "credentialprovider.h"
+#include "connmanconfig.h"
+
+#include <QDBusArgument>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+// the provider itself answers in well under this, used until a dialog was timed
+static const qint64 DefaultUiRoundTrip = 5 * 1000;
+
+static QVariantMap fieldProperties(const QVariant &value)
+{
+    if (value.canConvert<QDBusArgument>())
+        return qdbus_cast<QVariantMap>(value.value<QDBusArgument>());
+    return value.toMap();
+}
+
+CredentialProvider::CredentialProvider(const QString &fileName, QObject *parent) :
+    QObject(parent),
+    storeFileName(fileName),
+    storeSize(-1),
+    enabled(false),
+    answered(0),
+    fallbacks(0),
+    uiAnswers(0),
+    uiTotal(0),
+    timeSaved(0)
+{
+}
+
+CredentialProvider::~CredentialProvider()
+{
+}
+
+void CredentialProvider::setEnabled(bool enable)
+{
+    enabled = enable;
+}
+
+bool CredentialProvider::isEnabled() const
+{
+    return enabled;
+}
+
+bool CredentialProvider::answer(const QString &servicePath, const QVariantMap &fields, QVariantMap *reply)
+{
+    if (!enabled)
+        return false;
+
+    QHash<QString, QVariantMap> store;
+    if (!loadStore(&store))
+        return false;
+
+    const QString id = identifier(servicePath);
+    const QVariantMap credentials = store.value(id);
+    if (credentials.isEmpty()) {
+        fallbacks++;
+        return false;
+    }
+
+    // connman asking again before the service got up means the answer was wrong
+    if (outstanding.remove(id))
+        reject(id);
+    if (rejected.contains(id)) {
+        fallbacks++;
+        return false;
+    }
+
+    QVariantMap values;
+    for (QVariantMap::const_iterator it = fields.constBegin(); it != fields.constEnd(); ++it) {
+        const QString requirement = fieldProperties(it.value()).value(QStringLiteral("Requirement")).toString();
+        if (credentials.contains(it.key())) {
+            if (requirement != QLatin1String("informational"))
+                values.insert(it.key(), credentials.value(it.key()));
+        } else if (requirement == QLatin1String("mandatory")) {
+            qCDebug(connAgent) << "No provisioned" << it.key() << "for" << servicePath;
+            fallbacks++;
+            return false;
+        }
+    }
+
+    answered++;
+    outstanding.insert(id);
+    timeSaved += uiAnswers ? uiTotal / uiAnswers : DefaultUiRoundTrip;
+    qCInfo(connAgent) << "Answered input request for" << servicePath << "with provisioned" << values.keys();
+    *reply = values;
+    return true;
+}
+
+void CredentialProvider::recordState(NetworkService *service, NetworkService::ServiceState state)
+{
+    const QString id = identifier(service->path());
+    if (state == NetworkService::ReadyState || state == NetworkService::OnlineState) {
+        outstanding.remove(id);
+    } else if (state == NetworkService::FailureState) {
+        if (outstanding.remove(id))
+            reject(id);
+    }
+}
+
+void CredentialProvider::reject(const QString &id)
+{
+    qCWarning(connAgent) << "Provisioned credentials for" << id << "did not work, asking the user";
+    rejected.insert(id);
+}
+
+void CredentialProvider::uiAnswered(qint64 msecs)
+{
+    uiAnswers++;
+    uiTotal += msecs;
+}
+
+QVariantMap CredentialProvider::statistics() const
+{
+    QVariantMap stats;
+    stats.insert(QStringLiteral("Enabled"), enabled);
+    stats.insert(QStringLiteral("Answered"), answered);
+    stats.insert(QStringLiteral("FallBacks"), fallbacks);
+    stats.insert(QStringLiteral("Rejected"), rejected.count());
+    stats.insert(QStringLiteral("DialogAnswers"), uiAnswers);
+    stats.insert(QStringLiteral("AverageDialogTime"), uiAnswers ? uiTotal / uiAnswers : 0);
+    stats.insert(QStringLiteral("TimeSaved"), timeSaved);
+    return stats;
+}
+
+QString CredentialProvider::identifier(const QString &servicePath)
+{
+    return servicePath.section(QLatin1Char('/'), -1);
+}
+
+bool CredentialProvider::loadStore(QHash<QString, QVariantMap> *store)
+{
+    QFileInfo info(storeFileName);
+    if (!info.exists())
+        return false;
+
+    // edited credentials get another chance
+    if (info.lastModified() != storeModified || info.size() != storeSize) {
+        storeModified = info.lastModified();
+        storeSize = info.size();
+        rejected.clear();
+        outstanding.clear();
+    }
+
+    const QFile::Permissions others = QFile::ReadGroup | QFile::WriteGroup | QFile::ReadOther | QFile::WriteOther;
+    if (QFile::permissions(storeFileName) & others) {
+        qCWarning(connAgent) << "Ignoring" << storeFileName << ", it is readable by others";
+        return false;
+    }
+
+    QFile file(storeFileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    // keyfile syntax like connman's own files, values are taken as they are,
+    // so commas, quotes and a leading @ have no special meaning
+    const QHash<QString, QString> values = ConnmanConfig::parse(file.readAll());
+    for (QHash<QString, QString>::const_iterator it = values.constBegin(); it != values.constEnd(); ++it) {
+        const int separator = it.key().indexOf(QLatin1Char('/'));
+        (*store)[it.key().left(separator)].insert(it.key().mid(separator + 1), it.value());
+    }
+    return true;
+}
@@ -0,0 +1,80 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef CREDENTIALPROVIDER_H
+#define CREDENTIALPROVIDER_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QVariantMap>
+
+#include "networkservice.h"
+
+/*
+ * Answers connman input requests from provisioned credentials, so enterprise
+ * networks and hidden networks set up in advance reconnect without a dialog.
+ * Credentials are read from a keyfile with one group per service
+ * identifier (the last part of the service path) and one key per connman
+ * field; values are used verbatim apart from surrounding whitespace. Once
+ * provisioned credentials fail for a service, it is left to the dialog
+ * until the file changes.
+ *
+ * The keyfile is plain text, not a secrets store. It is ignored unless only
+ * its owner can read it, which is the same protection connman gives the
+ * passphrases in its own service settings under /var/lib/connman. The
+ * provider is off by default and meant for provisioned devices.
+ */
+class CredentialProvider : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CredentialProvider(const QString &fileName, QObject *parent = 0);
+    ~CredentialProvider();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    // Fills reply when every mandatory field can be answered
+    bool answer(const QString &servicePath, const QVariantMap &fields, QVariantMap *reply);
+    void recordState(NetworkService *service, NetworkService::ServiceState state);
+    void uiAnswered(qint64 msecs);
+
+    QVariantMap statistics() const;
+
+    static QString identifier(const QString &servicePath);
+
+private:
+    bool loadStore(QHash<QString, QVariantMap> *store);
+    void reject(const QString &id);
+
+    QString storeFileName;
+    QDateTime storeModified;
+    qint64 storeSize;
+    bool enabled;
+    // answered, waiting for the service to get up
+    QSet<QString> outstanding;
+    QSet<QString> rejected;
+
+    quint32 answered;
+    quint32 fallbacks;
+    quint32 uiAnswers;
+    qint64 uiTotal;
+    qint64 timeSaved;
+};
+
+#endif // CREDENTIALPROVIDER_H
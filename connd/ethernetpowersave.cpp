@@ -0,0 +1,119 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "ethernetpowersave.h"
+#include "eventjournal.h"
+#include "tracing.h"
+
+#include <connman-qt5/networkservice.h>
+
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+EthernetPowerSave::EthernetPowerSave(QObject *parent) :
+    QObject(parent),
+    enabled(true),
+    parkCellular(true),
+    active(false),
+    activeTime(0),
+    parkedTime(0),
+    scansSaved(0)
+{
+}
+
+EthernetPowerSave::~EthernetPowerSave()
+{
+}
+
+void EthernetPowerSave::setEnabled(bool enable)
+{
+    enabled = enable;
+    if (!enabled && active)
+        leave();
+}
+
+void EthernetPowerSave::setParkCellular(bool park)
+{
+    parkCellular = park;
+}
+
+bool EthernetPowerSave::isActive() const
+{
+    return active;
+}
+
+void EthernetPowerSave::update(bool wiredOnline, const QVector<NetworkService *> &cellular)
+{
+    if (wiredOnline && enabled && !active)
+        enter(cellular);
+    else if (!wiredOnline && active)
+        leave();
+}
+
+void EthernetPowerSave::scanSkipped()
+{
+    scansSaved++;
+}
+
+QVariantMap EthernetPowerSave::statistics() const
+{
+    const qint64 current = active ? activeSince.elapsed() : 0;
+
+    QVariantMap stats;
+    stats.insert(QStringLiteral("Active"), active);
+    stats.insert(QStringLiteral("WiredTime"), activeTime + current);
+    stats.insert(QStringLiteral("CellularParkedTime"), parkedTime + (parked.isEmpty() ? 0 : current));
+    stats.insert(QStringLiteral("ScansSaved"), scansSaved);
+    return stats;
+}
+
+void EthernetPowerSave::enter(const QVector<NetworkService *> &cellular)
+{
+    active = true;
+    activeSince.start();
+
+    if (parkCellular) {
+        for (NetworkService *service : cellular) {
+            if (service->autoConnect() && (service->serviceState() == NetworkService::ReadyState
+                                           || service->serviceState() == NetworkService::OnlineState)) {
+                parked << service;
+                EventJournal::request(EventJournal::Disconnect, service->path());
+                TRACE_CALL("requestDisconnect", service->requestDisconnect());
+            }
+        }
+    }
+    qCInfo(connAgent) << "Ethernet is up, suspending wifi scans" << (parked.isEmpty() ? "" : "and parking cellular");
+}
+
+void EthernetPowerSave::leave()
+{
+    const qint64 elapsed = activeSince.elapsed();
+    activeTime += elapsed;
+    if (!parked.isEmpty())
+        parkedTime += elapsed;
+    active = false;
+
+    for (const QPointer<NetworkService> &service : parked) {
+        if (service) {
+            EventJournal::request(EventJournal::Connect, service->path());
+            TRACE_CALL("requestConnect", service->requestConnect());
+        }
+    }
+    parked.clear();
+
+    qCInfo(connAgent) << "Ethernet went away after" << elapsed / 1000 << "s, resuming";
+    Q_EMIT resumed();
+}
@@ -0,0 +1,70 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef ETHERNETPOWERSAVE_H
+#define ETHERNETPOWERSAVE_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QVariantMap>
+#include <QVector>
+
+class NetworkService;
+
+/*
+ * While a wired connection is the online default route, periodic Wifi scans
+ * are skipped and cellular data can be parked (disconnected). Both are
+ * restored as soon as ethernet stops being the online default route.
+ */
+class EthernetPowerSave : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EthernetPowerSave(QObject *parent = 0);
+    ~EthernetPowerSave();
+
+    void setEnabled(bool enabled);
+    void setParkCellular(bool park);
+
+    bool isActive() const;
+    void update(bool wiredOnline, const QVector<NetworkService *> &cellular);
+    // a periodic scan was skipped because of the wired connection
+    void scanSkipped();
+
+    // Time spent on ethernet and with cellular parked; radio on-time itself
+    // is not visible through connman, the parked time is what was saved
+    QVariantMap statistics() const;
+
+Q_SIGNALS:
+    void resumed();
+
+private:
+    void enter(const QVector<NetworkService *> &cellular);
+    void leave();
+
+    bool enabled;
+    bool parkCellular;
+    bool active;
+    QVector<QPointer<NetworkService> > parked;
+
+    QElapsedTimer activeSince;
+    qint64 activeTime;
+    qint64 parkedTime;
+    quint32 scansSaved;
+};
+
+#endif // ETHERNETPOWERSAVE_H
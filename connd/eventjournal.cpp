@@ -0,0 +1,184 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "eventjournal.h"
+
+#include <QDataStream>
+#include <QHash>
+#include <QIODevice>
+
+#include <time.h>
+
+static const quint32 DumpMagic = 0x43414a31; // "CAJ1"
+static const quint32 DumpVersion = 1;
+
+struct Entry {
+    quint64 time;       // CLOCK_MONOTONIC in ns
+    quint8 event;
+    quint8 reserved;
+    quint16 subject;
+    quint32 value;
+};
+Q_STATIC_ASSERT(sizeof(Entry) == 16);
+
+static Entry ring[EventJournal::Capacity];
+static quint64 written;
+
+struct StringTable {
+    StringTable() { strings << QStringLiteral("?"); ids.insert(strings.first(), 0); }
+
+    QStringList strings;
+    QHash<QString, quint16> ids;
+};
+
+static StringTable &stringTable()
+{
+    static StringTable table;
+    return table;
+}
+
+static const char *eventName(quint8 event)
+{
+    switch (event) {
+    case EventJournal::ServiceState: return "service-state";
+    case EventJournal::GlobalState: return "global-state";
+    case EventJournal::Error: return "error";
+    case EventJournal::ConnectionRequest: return "connection-request";
+    case EventJournal::UserInput: return "user-input";
+    case EventJournal::Browser: return "browser";
+    case EventJournal::Tethering: return "tethering";
+    case EventJournal::Request: return "request";
+    case EventJournal::OfflineMode: return "offline-mode";
+    case EventJournal::Sleep: return "sleep";
+    }
+    return "unknown";
+}
+
+static QString valueName(quint8 event, quint32 value, const QStringList &strings)
+{
+    static const char *requests[] = {
+        "", "connect", "disconnect", "scan", "tethering-on", "tethering-off", "power-on", "power-off"
+    };
+    static const char *tethering[] = {
+        "", "starting", "up", "failed", "stopped", "idle-stopped"
+    };
+
+    switch (event) {
+    case EventJournal::ServiceState:
+    case EventJournal::GlobalState:
+    case EventJournal::Error:
+        return strings.value(value, QStringLiteral("?"));
+    case EventJournal::Request:
+        if (value < sizeof(requests) / sizeof(requests[0]))
+            return QLatin1String(requests[value]);
+        break;
+    case EventJournal::Tethering:
+        if (value < sizeof(tethering) / sizeof(tethering[0]))
+            return QLatin1String(tethering[value]);
+        break;
+    default:
+        break;
+    }
+    return QString::number(value);
+}
+
+quint16 EventJournal::intern(const QString &string)
+{
+    StringTable &table = stringTable();
+    QHash<QString, quint16>::const_iterator it = table.ids.constFind(string);
+    if (it != table.ids.constEnd())
+        return it.value();
+
+    if (table.strings.count() >= MaxStrings)
+        return 0;
+
+    quint16 id = table.strings.count();
+    table.strings << string;
+    table.ids.insert(string, id);
+    return id;
+}
+
+void EventJournal::record(Event event, quint16 subject, quint32 value)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    Entry &entry = ring[written++ % Capacity];
+    entry.time = quint64(now.tv_sec) * 1000000000 + now.tv_nsec;
+    entry.event = event;
+    entry.reserved = 0;
+    entry.subject = subject;
+    entry.value = value;
+}
+
+QByteArray EventJournal::dump()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    const quint32 count = qMin<quint64>(written, Capacity);
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << DumpMagic << DumpVersion
+        << quint64(quint64(now.tv_sec) * 1000000000 + now.tv_nsec)
+        << stringTable().strings << count;
+
+    for (quint64 i = written - count; i < written; ++i) {
+        const Entry &entry = ring[i % Capacity];
+        out << entry.time << entry.event << entry.subject << entry.value;
+    }
+    return data;
+}
+
+QStringList EventJournal::decode(const QByteArray &data, bool *ok)
+{
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint64 dumpTime = 0;
+    QStringList strings;
+    quint32 count = 0;
+    in >> magic >> version >> dumpTime >> strings >> count;
+
+    QStringList lines;
+    if (in.status() != QDataStream::Ok || magic != DumpMagic || version != DumpVersion || count > Capacity) {
+        if (ok)
+            *ok = false;
+        return lines;
+    }
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        quint64 time;
+        quint8 event;
+        quint16 subject;
+        quint32 value;
+        in >> time >> event >> subject >> value;
+
+        // seconds before the dump was taken
+        const double age = (qint64(dumpTime) - qint64(time)) / 1e9;
+        lines << QStringLiteral("-%1s %2 %3 %4")
+                 .arg(age, 0, 'f', 6)
+                 .arg(QLatin1String(eventName(event)), -18)
+                 .arg(subject ? strings.value(subject, QStringLiteral("?")) : QStringLiteral("-"))
+                 .arg(valueName(event, value, strings));
+    }
+
+    if (ok)
+        *ok = in.status() == QDataStream::Ok;
+    return lines;
+}
@@ -0,0 +1,87 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef EVENTJOURNAL_H
+#define EVENTJOURNAL_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+/*
+ * Fixed-size binary ring of the connman facing events the agent handles,
+ * kept for postmortems while debug output is off. The ring is allocated
+ * statically and an entry is a 16 byte record of a monotonic timestamp,
+ * the event, an interned subject (service path, technology, error) and a
+ * value, so recording never allocates. Only strings seen for the first
+ * time are allocated when interned.
+ *
+ * dump() serializes the ring with its string table; decode() turns a dump
+ * back into text, for the DumpJournal D-Bus method and the decoder tool.
+ */
+namespace EventJournal {
+
+enum Event {
+    ServiceState = 1,     // subject service, value interned state name
+    GlobalState,          // value interned state name
+    Error,                // subject service, value interned error
+    ConnectionRequest,    // value 1 when the dialog was requested
+    UserInput,            // subject service, value 1 answered without dialog
+    Browser,              // subject service, value 1 when opened
+    Tethering,            // subject technology, value TetheringEvent
+    Request,              // subject service or technology, value RequestKind
+    OfflineMode,          // value 1 when offline
+    Sleep                 // value 1 going to sleep, 0 resumed
+};
+
+enum RequestKind {
+    Connect = 1,
+    Disconnect,
+    Scan,
+    TetheringOn,
+    TetheringOff,
+    PowerOn,
+    PowerOff
+};
+
+enum TetheringEvent {
+    TetheringStarting = 1,
+    TetheringUp,
+    TetheringFailed,
+    TetheringStopped,
+    TetheringIdleStopped
+};
+
+enum { Capacity = 4096, MaxStrings = 4096 };
+
+quint16 intern(const QString &string);
+void record(Event event, quint16 subject = 0, quint32 value = 0);
+
+inline void record(Event event, const QString &subject, quint32 value = 0)
+{
+    record(event, intern(subject), value);
+}
+
+inline void request(RequestKind kind, const QString &subject)
+{
+    record(Request, intern(subject), kind);
+}
+
+QByteArray dump();
+QStringList decode(const QByteArray &dump, bool *ok = 0);
+
+}
+
+#endif // EVENTJOURNAL_H
@@ -0,0 +1,225 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "handovercontroller.h"
+#include "eventjournal.h"
+#include "tracing.h"
+
+#include <connman-qt5/networkservice.h>
+
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+// after cellular is dropped, how long to keep watching for a connectivity gap
+static const int SettleTime = 5 * 1000;
+
+HandoverController::HandoverController(QObject *parent) :
+    QObject(parent),
+    makeBeforeBreak(true),
+    keepCellular(false),
+    broken(false),
+    tracking(false),
+    overdue(false),
+    online(true),
+    gap(0),
+    handovers(0),
+    aborted(0),
+    late(0),
+    lastGap(0),
+    maxGap(0),
+    totalGap(0)
+{
+    deadline.setSingleShot(true);
+    deadline.setInterval(15 * 1000);
+    connect(&deadline, &QTimer::timeout, this, &HandoverController::deadlineExpired);
+
+    settleTimer.setSingleShot(true);
+    settleTimer.setInterval(SettleTime);
+    connect(&settleTimer, &QTimer::timeout, this, &HandoverController::settle);
+}
+
+HandoverController::~HandoverController()
+{
+}
+
+void HandoverController::setMakeBeforeBreak(bool enabled)
+{
+    makeBeforeBreak = enabled;
+}
+
+void HandoverController::setDeadline(int msecs)
+{
+    deadline.setInterval(msecs);
+}
+
+void HandoverController::setKeepCellular(bool keep)
+{
+    keepCellular = keep;
+}
+
+bool HandoverController::isActive() const
+{
+    return tracking;
+}
+
+void HandoverController::begin(NetworkService *wifi, NetworkService *cellular)
+{
+    if (tracking && wifi == wifiService)
+        return;
+    if (tracking)
+        abort("superseded");
+
+    wifiService = wifi;
+    cellularService = cellular;
+    broken = false;
+    tracking = true;
+    overdue = false;
+    gap = 0;
+    clock.start();
+    if (!online)
+        offlineSince.start();
+
+    qCInfo(connAgent) << "Handover from" << cellular->path() << "to" << wifi->path()
+                      << (makeBeforeBreak ? "(make before break)" : "");
+
+    if (!makeBeforeBreak) {
+        breakCellular();
+        return;
+    }
+
+    connect(wifi, &NetworkService::serviceStateChanged, this, &HandoverController::wifiStateChanged);
+    deadline.start();
+    if (wifi->serviceState() == NetworkService::OnlineState)
+        confirm(wifi);
+}
+
+void HandoverController::confirm(NetworkService *wifi)
+{
+    if (!tracking || broken || wifi != wifiService)
+        return;
+
+    qCInfo(connAgent) << "Handover:" << wifi->path() << "confirmed after" << clock.elapsed() << "ms";
+    breakCellular();
+}
+
+void HandoverController::globalStateChanged(bool isOnline)
+{
+    if (online == isOnline)
+        return;
+
+    online = isOnline;
+    if (!tracking)
+        return;
+
+    if (!online) {
+        offlineSince.start();
+    } else if (offlineSince.isValid()) {
+        gap += offlineSince.elapsed();
+        offlineSince.invalidate();
+        if (broken)
+            finish();
+    }
+}
+
+QVariantMap HandoverController::statistics() const
+{
+    QVariantMap stats;
+    stats.insert(QStringLiteral("MakeBeforeBreak"), makeBeforeBreak);
+    stats.insert(QStringLiteral("Handovers"), handovers);
+    stats.insert(QStringLiteral("Aborted"), aborted);
+    stats.insert(QStringLiteral("Late"), late);
+    stats.insert(QStringLiteral("LastGap"), lastGap);
+    stats.insert(QStringLiteral("MaxGap"), maxGap);
+    stats.insert(QStringLiteral("AverageGap"), handovers ? totalGap / handovers : 0);
+    return stats;
+}
+
+void HandoverController::wifiStateChanged(NetworkService::ServiceState state)
+{
+    TRACE_FUNCTION();
+    if (state == NetworkService::OnlineState) {
+        confirm(wifiService);
+    } else if (state == NetworkService::FailureState || state == NetworkService::IdleState
+               || state == NetworkService::DisconnectState) {
+        abort("wifi went away");
+    }
+}
+
+void HandoverController::deadlineExpired()
+{
+    TRACE_FUNCTION();
+    // Ready but not Online: most likely a captive portal or a slow online
+    // check, stay on cellular until the wifi makes it or goes away
+    qCInfo(connAgent) << "Handover:" << (wifiService ? wifiService->path() : QString())
+                      << "not online in time, keeping cellular until it is";
+    overdue = true;
+    late++;
+}
+
+void HandoverController::settle()
+{
+    TRACE_FUNCTION();
+    if (tracking && broken)
+        finish();
+}
+
+void HandoverController::breakCellular()
+{
+    deadline.stop();
+    broken = true;
+    if (wifiService)
+        wifiService->disconnect(this);
+    if (cellularService && !keepCellular) {
+        EventJournal::request(EventJournal::Disconnect, cellularService->path());
+        TRACE_CALL("requestDisconnect", cellularService->requestDisconnect());
+    }
+    settleTimer.start();
+}
+
+void HandoverController::abort(const char *reason)
+{
+    qCInfo(connAgent) << "Handover aborted after" << clock.elapsed() << "ms:" << reason;
+    deadline.stop();
+    settleTimer.stop();
+    if (wifiService)
+        wifiService->disconnect(this);
+    wifiService.clear();
+    cellularService.clear();
+    offlineSince.invalidate();
+    tracking = false;
+    aborted++;
+}
+
+void HandoverController::finish()
+{
+    settleTimer.stop();
+    if (offlineSince.isValid()) {
+        gap += offlineSince.elapsed();
+        offlineSince.invalidate();
+    }
+
+    handovers++;
+    lastGap = gap;
+    maxGap = qMax(maxGap, gap);
+    totalGap += gap;
+    qCInfo(connAgent) << "Handover to" << (wifiService ? wifiService->path() : QString())
+                      << "done in" << clock.elapsed() << "ms" << (overdue ? "(late)" : "")
+                      << ", connectivity gap" << gap << "ms";
+
+    wifiService.clear();
+    cellularService.clear();
+    tracking = false;
+}
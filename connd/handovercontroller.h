@@ -0,0 +1,90 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef HANDOVERCONTROLLER_H
+#define HANDOVERCONTROLLER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QTimer>
+#include <QVariantMap>
+
+#include "networkservice.h"
+
+/*
+ * Hands the connection over from cellular to a Wifi service that has just
+ * become Ready. In make-before-break mode cellular is only disconnected once
+ * the Wifi service is confirmed usable (Online, or a passed HTTP check).
+ * Past the deadline (a captive portal, a slow online check) cellular is
+ * kept until that happens; the handover is only given up when the Wifi
+ * service goes away or another one takes over. The time spent without
+ * connectivity during each handover is measured. When cellular is to stay
+ * connected anyway (connman's AlwaysConnectedTechnologies) it is left up.
+ */
+class HandoverController : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HandoverController(QObject *parent = 0);
+    ~HandoverController();
+
+    void setMakeBeforeBreak(bool enabled);
+    void setDeadline(int msecs);
+    void setKeepCellular(bool keep);
+
+    bool isActive() const;
+    void begin(NetworkService *wifi, NetworkService *cellular);
+    // The Wifi service was proven to work, e.g. by an HTTP online check
+    void confirm(NetworkService *wifi);
+    void globalStateChanged(bool online);
+
+    QVariantMap statistics() const;
+
+private slots:
+    void wifiStateChanged(NetworkService::ServiceState state);
+    void deadlineExpired();
+    void settle();
+
+private:
+    void breakCellular();
+    void abort(const char *reason);
+    void finish();
+
+    bool makeBeforeBreak;
+    bool keepCellular;
+    QPointer<NetworkService> wifiService;
+    QPointer<NetworkService> cellularService;
+    bool broken;
+    bool tracking;
+    bool overdue;
+    bool online;
+
+    QElapsedTimer clock;
+    QElapsedTimer offlineSince;
+    qint64 gap;
+    QTimer deadline;
+    QTimer settleTimer;
+
+    quint32 handovers;
+    quint32 aborted;
+    quint32 late;
+    qint64 lastGap;
+    qint64 maxGap;
+    qint64 totalGap;
+};
+
+#endif // HANDOVERCONTROLLER_H
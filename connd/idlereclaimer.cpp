@@ -0,0 +1,176 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "idlereclaimer.h"
+#include "tracing.h"
+
+#include <QFile>
+#include <QLoggingCategory>
+#include <QSocketNotifier>
+
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+// 150 ms of stalls on memory within 2 s, the shortest window allowed
+// for unprivileged triggers
+static const char PressureTrigger[] = "some 150000 2000000";
+// pressure comes in bursts, reclaiming once per burst is enough
+static const qint64 PressureInterval = 10 * 1000;
+
+IdleReclaimer::IdleReclaimer(QObject *parent) :
+    QObject(parent),
+    enabled(true),
+    idleState(false),
+    pressureFd(-1),
+    pressureNotifier(nullptr),
+    reclaims(0),
+    pressureEvents(0),
+    lastRssBefore(-1),
+    lastRssAfter(-1),
+    totalFreed(0)
+{
+    idleTimer.setSingleShot(true);
+    idleTimer.setInterval(5 * 60 * 1000);
+    connect(&idleTimer, &QTimer::timeout, this, &IdleReclaimer::idle);
+}
+
+IdleReclaimer::~IdleReclaimer()
+{
+    if (pressureFd >= 0)
+        ::close(pressureFd);
+}
+
+void IdleReclaimer::setEnabled(bool enable)
+{
+    enabled = enable;
+    if (enabled)
+        activity();
+    else
+        idleTimer.stop();
+}
+
+void IdleReclaimer::setIdleDelay(int msecs)
+{
+    idleTimer.setInterval(qMax(1000, msecs));
+}
+
+void IdleReclaimer::activity()
+{
+    if (enabled)
+        idleTimer.start();
+
+    if (idleState) {
+        idleState = false;
+        qCDebug(connAgent) << "Leaving idle mode";
+        Q_EMIT active();
+    }
+}
+
+void IdleReclaimer::enterIdle()
+{
+    idleTimer.stop();
+    idleState = true;
+}
+
+bool IdleReclaimer::isIdle() const
+{
+    return idleState;
+}
+
+bool IdleReclaimer::watchPressure(const QString &fileName)
+{
+    if (pressureFd >= 0)
+        return true;
+
+    int fd = ::open(QFile::encodeName(fileName).constData(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    // the trigger is registered by writing it, including the terminating null
+    if (::write(fd, PressureTrigger, sizeof(PressureTrigger)) < 0) {
+        qCDebug(connAgent) << "Cannot set memory pressure trigger on" << fileName;
+        ::close(fd);
+        return false;
+    }
+
+    pressureFd = fd;
+    // trigger events are signalled as POLLPRI
+    pressureNotifier = new QSocketNotifier(fd, QSocketNotifier::Exception, this);
+    connect(pressureNotifier, &QSocketNotifier::activated, this, &IdleReclaimer::pressureEvent);
+    return true;
+}
+
+void IdleReclaimer::reclaimed(const QString &reason, qint64 rssBefore, qint64 rssAfter)
+{
+    reclaims++;
+    lastReason = reason;
+    lastRssBefore = rssBefore;
+    lastRssAfter = rssAfter;
+    if (rssBefore >= 0 && rssAfter >= 0)
+        totalFreed += qMax<qint64>(0, rssBefore - rssAfter);
+}
+
+QVariantMap IdleReclaimer::statistics() const
+{
+    QVariantMap stats;
+    stats.insert(QStringLiteral("Idle"), idleState);
+    stats.insert(QStringLiteral("Rss"), residentSize());
+    stats.insert(QStringLiteral("Reclaims"), reclaims);
+    stats.insert(QStringLiteral("LastReason"), lastReason);
+    stats.insert(QStringLiteral("RssBefore"), lastRssBefore);
+    stats.insert(QStringLiteral("RssAfter"), lastRssAfter);
+    stats.insert(QStringLiteral("Freed"), totalFreed);
+    stats.insert(QStringLiteral("PressureWatched"), pressureFd >= 0);
+    stats.insert(QStringLiteral("PressureEvents"), pressureEvents);
+    return stats;
+}
+
+qint64 IdleReclaimer::residentSize()
+{
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly))
+        return -1;
+
+    // size resident shared text lib data dt, in pages
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.count() < 2)
+        return -1;
+
+    return fields.at(1).toLongLong() * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+void IdleReclaimer::releaseHeap()
+{
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+}
+
+void IdleReclaimer::pressureEvent()
+{
+    TRACE_FUNCTION();
+    pressureEvents++;
+    if (lastPressure.isValid() && lastPressure.elapsed() < PressureInterval)
+        return;
+
+    lastPressure.start();
+    qCInfo(connAgent) << "Memory pressure";
+    Q_EMIT pressure();
+}
@@ -0,0 +1,84 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef IDLERECLAIMER_H
+#define IDLERECLAIMER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVariantMap>
+
+class QSocketNotifier;
+
+/*
+ * Decides when the agent is idle: no activity (client calls, connman agent
+ * requests, service state changes) for the idle delay. The owner then
+ * drops what it can rebuild on demand and calls enterIdle(); any activity
+ * ends the idle mode. Memory pressure reported by the kernel (PSI) asks for
+ * the same reclaim regardless of activity. The resident size before and
+ * after each reclaim is kept for statistics().
+ */
+class IdleReclaimer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit IdleReclaimer(QObject *parent = 0);
+    ~IdleReclaimer();
+
+    void setEnabled(bool enabled);
+    void setIdleDelay(int msecs);
+
+    void activity();
+    void enterIdle();
+    bool isIdle() const;
+
+    // Registers a PSI trigger, false when the kernel has no PSI support
+    bool watchPressure(const QString &fileName = QStringLiteral("/proc/pressure/memory"));
+
+    void reclaimed(const QString &reason, qint64 rssBefore, qint64 rssAfter);
+    QVariantMap statistics() const;
+
+    // Resident set size of the process in kB, -1 when unknown
+    static qint64 residentSize();
+    // Returns free heap pages to the kernel
+    static void releaseHeap();
+
+Q_SIGNALS:
+    void idle();
+    void active();
+    void pressure();
+
+private slots:
+    void pressureEvent();
+
+private:
+    bool enabled;
+    bool idleState;
+    QTimer idleTimer;
+    int pressureFd;
+    QSocketNotifier *pressureNotifier;
+    QElapsedTimer lastPressure;
+
+    quint32 reclaims;
+    quint32 pressureEvents;
+    QString lastReason;
+    qint64 lastRssBefore;
+    qint64 lastRssAfter;
+    qint64 totalFreed;
+};
+
+#endif // IDLERECLAIMER_H
@@ -0,0 +1,138 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+
+#include "lagmonitor.h"
+#include "metrics.h"
+#include "tracing.h"
+
+#include <QLoggingCategory>
+#include <QMutexLocker>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+LagMonitor::LagMonitor(Metrics *metrics, QObject *parent) :
+    QThread(parent),
+    metrics(metrics),
+    handler(nullptr),
+    interval(1000),
+    threshold(500),
+    stopping(false),
+    answered(0),
+    stallStarted(-1),
+    stalls(0),
+    lastLag(0),
+    maxLag(0),
+    longestStall(0)
+{
+    clock.start();
+}
+
+LagMonitor::~LagMonitor()
+{
+    stopMonitoring();
+}
+
+void LagMonitor::setInterval(int msecs)
+{
+    QMutexLocker locker(&mutex);
+    interval = qMax(10, msecs);
+}
+
+void LagMonitor::setThreshold(int msecs)
+{
+    QMutexLocker locker(&mutex);
+    threshold = qMax(1, msecs);
+}
+
+void LagMonitor::startMonitoring()
+{
+    if (isRunning())
+        return;
+
+    handler = Tracing::currentSpan();
+    Tracing::setWatched(true);
+    stopping = false;
+    start(QThread::LowPriority);
+}
+
+void LagMonitor::stopMonitoring()
+{
+    {
+        QMutexLocker locker(&mutex);
+        stopping = true;
+        wake.wakeOne();
+    }
+    wait();
+    Tracing::setWatched(false);
+}
+
+QVariantMap LagMonitor::statistics() const
+{
+    QMutexLocker locker(&mutex);
+    QVariantMap stats;
+    stats.insert(QStringLiteral("Interval"), interval);
+    stats.insert(QStringLiteral("Threshold"), threshold);
+    stats.insert(QStringLiteral("Stalls"), stalls);
+    stats.insert(QStringLiteral("LastLag"), lastLag);
+    stats.insert(QStringLiteral("MaxLag"), maxLag);
+    stats.insert(QStringLiteral("LongestStall"), longestStall);
+    stats.insert(QStringLiteral("LongestStallHandler"), longestStallHandler);
+    return stats;
+}
+
+void LagMonitor::pong(qint64 sent)
+{
+    const qint64 lag = clock.nsecsElapsed() - sent;
+    metrics->record(QStringLiteral("event_loop_lag"), lag / 1000);
+
+    QMutexLocker locker(&mutex);
+    answered = sent;
+    lastLag = lag / 1000000;
+    maxLag = qMax(maxLag, lastLag);
+    if (stallStarted >= 0) {
+        qCWarning(connAgent) << "Main loop was blocked for" << lastLag << "ms in" << stallHandler;
+        if (lastLag > longestStall) {
+            longestStall = lastLag;
+            longestStallHandler = stallHandler;
+        }
+        stallStarted = -1;
+    }
+    wake.wakeOne();
+}
+
+void LagMonitor::run()
+{
+    QMutexLocker locker(&mutex);
+    while (!stopping) {
+        const qint64 sent = clock.nsecsElapsed();
+        QMetaObject::invokeMethod(this, "pong", Qt::QueuedConnection, Q_ARG(qint64, sent));
+
+        // one ping in flight at a time, a blocked loop does not pile them up
+        while (!stopping && answered != sent) {
+            wake.wait(&mutex, threshold);
+            const qint64 waited = (clock.nsecsElapsed() - sent) / 1000000;
+            if (answered != sent && stallStarted < 0 && waited >= threshold) {
+                const char *name = handler->load(std::memory_order_relaxed);
+                stallHandler = QString::fromLatin1(name ? name : "unknown handler");
+                stallStarted = sent;
+                stalls++;
+                qCWarning(connAgent) << "Main loop stalled for" << waited << "ms in" << stallHandler;
+            }
+        }
+        if (!stopping)
+            wake.wait(&mutex, interval);
+    }
+}
@@ -0,0 +1,83 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+
+#ifndef LAGMONITOR_H
+#define LAGMONITOR_H
+
+#include <QThread>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QVariantMap>
+#include <QWaitCondition>
+
+#include <atomic>
+
+class Metrics;
+
+/*
+ * Measures how long events wait in the main event loop. A watchdog thread
+ * posts a ping to the loop every interval and the loop records the time it
+ * took to get to it in the event_loop_lag histogram. When a ping stays
+ * unanswered past the threshold, the watchdog logs a warning naming the
+ * span the main thread is in, i.e. the slot or D-Bus call that blocks.
+ *
+ * The monitor itself lives in the main thread, only run() does not.
+ */
+class LagMonitor : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit LagMonitor(Metrics *metrics, QObject *parent = 0);
+    ~LagMonitor();
+
+    void setInterval(int msecs);
+    void setThreshold(int msecs);
+
+    // To be called from the thread to monitor
+    void startMonitoring();
+    void stopMonitoring();
+
+    QVariantMap statistics() const;
+
+protected:
+    void run() override;
+
+private slots:
+    void pong(qint64 sent);
+
+private:
+    Metrics *metrics;
+    std::atomic<const char *> *handler;
+    QElapsedTimer clock;
+
+    mutable QMutex mutex;
+    QWaitCondition wake;
+    int interval;
+    int threshold;
+    bool stopping;
+    qint64 answered;
+    qint64 stallStarted;
+    QString stallHandler;
+
+    quint32 stalls;
+    qint64 lastLag;
+    qint64 maxLag;
+    qint64 longestStall;
+    QString longestStallHandler;
+};
+
+#endif // LAGMONITOR_H
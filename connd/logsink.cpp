@@ -0,0 +1,159 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "logsink.h"
+
+#include <QCoreApplication>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+
+LogSink *LogSink::instance()
+{
+    static LogSink sink;
+    return &sink;
+}
+
+LogSink::LogSink() :
+    previousHandler(nullptr),
+    outputEnabled(false),
+    defaultOutput(false),
+    writing(false),
+    stopping(false),
+    droppedCount(0),
+    droppedReported(0)
+{
+}
+
+LogSink::~LogSink()
+{
+    if (previousHandler)
+        qInstallMessageHandler(previousHandler);
+
+    {
+        QMutexLocker locker(&mutex);
+        stopping = true;
+        wake.wakeOne();
+    }
+    wait();
+}
+
+void LogSink::install()
+{
+    if (previousHandler)
+        return;
+
+    previousHandler = qInstallMessageHandler(LogSink::handleMessage);
+    start(QThread::LowPriority);
+}
+
+void LogSink::setOutputEnabled(bool enabled)
+{
+    QMutexLocker locker(&mutex);
+    outputEnabled = enabled;
+    defaultOutput = enabled;
+}
+
+bool LogSink::isOutputEnabled() const
+{
+    QMutexLocker locker(&mutex);
+    return outputEnabled;
+}
+
+void LogSink::setFilterRules(const QString &filterRules)
+{
+    QLoggingCategory::setFilterRules(filterRules);
+    QMutexLocker locker(&mutex);
+    rules = filterRules;
+    outputEnabled = filterRules.isEmpty() ? defaultOutput : true;
+}
+
+QString LogSink::filterRules() const
+{
+    QMutexLocker locker(&mutex);
+    return rules;
+}
+
+quint64 LogSink::dropped() const
+{
+    QMutexLocker locker(&mutex);
+    return droppedCount;
+}
+
+void LogSink::handleMessage(QtMsgType type, const QMessageLogContext &context, const QString &text)
+{
+    instance()->post(type, context, text);
+}
+
+void LogSink::post(QtMsgType type, const QMessageLogContext &context, const QString &text)
+{
+    if (type == QtFatalMsg) {
+        // about to abort, get everything out first
+        flush();
+        previousHandler(type, context, text);
+        return;
+    }
+
+    QMutexLocker locker(&mutex);
+    if (!outputEnabled)
+        return;
+    if (queue.count() >= Capacity) {
+        droppedCount++;
+        return;
+    }
+
+    // the context strings are literals, keeping the pointers is enough
+    Message message = { type, context.file, context.line, context.function, context.category, text };
+    queue.enqueue(message);
+    wake.wakeOne();
+}
+
+void LogSink::flush()
+{
+    QMutexLocker locker(&mutex);
+    while ((!queue.isEmpty() || writing) && isRunning())
+        drained.wait(&mutex);
+}
+
+void LogSink::run()
+{
+    QMutexLocker locker(&mutex);
+    forever {
+        while (queue.isEmpty() && !stopping)
+            wake.wait(&mutex);
+        if (queue.isEmpty() && stopping)
+            break;
+
+        QQueue<Message> batch;
+        batch.swap(queue);
+        const quint64 newlyDropped = droppedCount - droppedReported;
+        droppedReported = droppedCount;
+        writing = true;
+        locker.unlock();
+
+        for (const Message &message : batch) {
+            QMessageLogContext context(message.file, message.line, message.function, message.category);
+            previousHandler(message.type, context, message.text);
+        }
+        if (newlyDropped) {
+            QMessageLogContext context;
+            previousHandler(QtWarningMsg, context,
+                            QStringLiteral("%1 log messages dropped, writer fell behind").arg(newlyDropped));
+        }
+
+        locker.relock();
+        writing = false;
+        drained.wakeAll();
+    }
+}
@@ -0,0 +1,89 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef LOGSINK_H
+#define LOGSINK_H
+
+#include <QThread>
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+#include <QWaitCondition>
+
+/*
+ * Message handler that hands log messages to a writer thread, which passes
+ * them on to the previously installed handler (stderr or journald). The
+ * queue is bounded: when the writer falls behind new messages are dropped
+ * and counted instead of blocking the caller. Fatal messages are written
+ * synchronously after the queue has drained.
+ *
+ * Output is off unless enabled, matching the old -d switch; which
+ * categories are let through is up to the QLoggingCategory filter rules.
+ */
+class LogSink : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum { Capacity = 1024 };
+
+    static LogSink *instance();
+
+    void install();
+    // the state at startup, i.e. -d
+    void setOutputEnabled(bool enabled);
+    bool isOutputEnabled() const;
+
+    // "" restores the built-in rules and the output state given at startup
+    void setFilterRules(const QString &rules);
+    QString filterRules() const;
+
+    quint64 dropped() const;
+
+protected:
+    void run() override;
+
+private:
+    struct Message {
+        QtMsgType type;
+        const char *file;
+        int line;
+        const char *function;
+        const char *category;
+        QString text;
+    };
+
+    LogSink();
+    ~LogSink();
+
+    static void handleMessage(QtMsgType type, const QMessageLogContext &context, const QString &text);
+    void post(QtMsgType type, const QMessageLogContext &context, const QString &text);
+    void flush();
+
+    QtMessageHandler previousHandler;
+    mutable QMutex mutex;
+    QWaitCondition wake;
+    QWaitCondition drained;
+    QQueue<Message> queue;
+    QString rules;
+    bool outputEnabled;
+    bool defaultOutput;
+    bool writing;
+    bool stopping;
+    quint64 droppedCount;
+    quint64 droppedReported;
+};
+
+#endif // LOGSINK_H
@@ -16,6 +16,7 @@
 
 #include <QtCore/QCoreApplication>
 #include <QTimer>
+#include <QScopedPointer>
 #include <QtGlobal>
 #include <QDebug>
 #include <signal.h>
@@ -26,14 +27,14 @@
 
 #include "qconnectionagent.h"
 #include "connectiond_adaptor.h"
+#include "tracing.h"
+#include "logsink.h"
+#include "startuptimings.h"
+#include "unixsignalnotifier.h"
 
-static void signal_handler(int signum)
-{
-    switch(signum) {
-    case SIGHUP: exit(EXIT_FAILURE); break;
-    case SIGTERM: exit(EXIT_SUCCESS); exit(0); break;
-    }
-}
+#ifdef HAS_BOOSTER
+#include <mdeclarativecache5/MDeclarativeCache>
+#endif
 
 static void daemonize(void)
 {
@@ -42,9 +43,6 @@ static void daemonize(void)
 
     if ( getppid() == 1 ) return;
 
-    signal(SIGHUP,signal_handler);
-    signal(SIGTERM,signal_handler);
-
     pid = fork();
     if (pid < 0) {
         exit(EXIT_FAILURE);
@@ -77,24 +75,20 @@ static void daemonize(void)
     umask(027);
 }
 
-static QtMessageHandler previousMessageHandler;
-static bool toggleDebug;
-
-void messageOutput(QtMsgType type, const QMessageLogContext &context, const QString &str)
-{
-    if (toggleDebug)
-        previousMessageHandler(type,context,str);
-}
-
 Q_DECL_EXPORT int main(int argc, char *argv[])
 {
-    previousMessageHandler = qInstallMessageHandler(messageOutput);
+    StartupTimings::instance()->start();
 
-    if (argc > 1) {
-        if (strcmp(argv[1],"-n") == 0) { //nodaemon
+    // logging goes through a writer thread, off unless -d or enabled over D-Bus
+    LogSink::instance()->install();
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i],"-n") == 0) { //nodaemon
             daemonize();
-        } else if (strcmp(argv[1],"-d") == 0) { //debug
-            toggleDebug = true;
+        } else if (strcmp(argv[i],"-d") == 0) { //debug
+            LogSink::instance()->setOutputEnabled(true);
+        } else if (strcmp(argv[i],"-t") == 0) { //trace spans, fetched with DumpTrace
+            Tracing::setEnabled(true);
         }
     }
     QCoreApplication::setOrganizationName("nemomobile");
@@ -102,7 +96,19 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
     QCoreApplication::setApplicationName("connectionagent");
     QCoreApplication::setApplicationVersion("1.0");
 
-    QCoreApplication a(argc, argv);
+    StartupTimings::instance()->begin("application");
+    QScopedPointer<QCoreApplication> app;
+#ifdef HAS_BOOSTER
+    // Launched through invoker the booster has already created the
+    // application, take that one instead of paying for a second
+    if (QCoreApplication::instance()) {
+        app.reset(MDeclarativeCache::qApplication(argc, argv));
+        StartupTimings::instance()->setBoosted(true);
+    }
+#endif
+    if (!app)
+        app.reset(new QCoreApplication(argc, argv));
+    StartupTimings::instance()->end("application");
 
     QConnectionAgent agent;
     if (!agent.isValid()) {
@@ -110,6 +116,18 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
         return 1;
     }
 
-    return a.exec();
+    // leave through the event loop so the agent can save its state
+    UnixSignalNotifier *notifier = UnixSignalNotifier::instance();
+    QObject::connect(notifier, &UnixSignalNotifier::received, app.data(), [](int signum) {
+        if (signum == SIGTERM)
+            QCoreApplication::exit(EXIT_SUCCESS);
+        else if (signum == SIGHUP)
+            QCoreApplication::exit(EXIT_FAILURE);
+    });
+    notifier->watch(SIGTERM);
+    notifier->watch(SIGHUP);
+    QObject::connect(app.data(), &QCoreApplication::aboutToQuit, &agent, &QConnectionAgent::shutdown);
+
+    return app->exec();
 }
 
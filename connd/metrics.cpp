@@ -0,0 +1,160 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "metrics.h"
+#include "tracing.h"
+#include "unixsignalnotifier.h"
+
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QStringList>
+#include <QTextStream>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+// upper bounds in microseconds, the last bucket takes everything above
+static const qint64 BucketBounds[Metrics::BucketCount - 1] = {
+    10, 100, 1000, 5000, 10000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 30000000, 60000000
+};
+
+Metrics::Metrics(QObject *parent) :
+    QObject(parent),
+    dumpSignal(0)
+{
+}
+
+Metrics::~Metrics()
+{
+}
+
+void Metrics::increment(const QString &name, quint64 amount)
+{
+    counters[name] += amount;
+}
+
+void Metrics::record(const QString &name, qint64 usecs)
+{
+    Histogram &h = histograms[name];
+    h.buckets[bucket(usecs)]++;
+    h.count++;
+    h.sum += usecs;
+    h.max = qMax(h.max, usecs);
+}
+
+quint64 Metrics::counter(const QString &name) const
+{
+    return counters.value(name);
+}
+
+int Metrics::bucket(qint64 usecs)
+{
+    int i = 0;
+    while (i < BucketCount - 1 && usecs > BucketBounds[i])
+        ++i;
+    return i;
+}
+
+qint64 Metrics::bucketBound(int index)
+{
+    return index < BucketCount - 1 ? BucketBounds[index] : -1;
+}
+
+QVariantMap Metrics::toVariantMap() const
+{
+    QVariantMap counterMap;
+    for (QHash<QString, quint64>::const_iterator it = counters.constBegin(); it != counters.constEnd(); ++it)
+        counterMap.insert(it.key(), it.value());
+
+    QVariantList bounds;
+    for (int i = 0; i < BucketCount; ++i)
+        bounds << bucketBound(i);
+
+    QVariantMap histogramMap;
+    for (QHash<QString, Histogram>::const_iterator it = histograms.constBegin(); it != histograms.constEnd(); ++it) {
+        QVariantList buckets;
+        for (int i = 0; i < BucketCount; ++i)
+            buckets << it->buckets[i];
+
+        QVariantMap h;
+        h.insert(QStringLiteral("Bounds"), bounds);
+        h.insert(QStringLiteral("Buckets"), buckets);
+        h.insert(QStringLiteral("Count"), it->count);
+        h.insert(QStringLiteral("Sum"), it->sum);
+        h.insert(QStringLiteral("Max"), it->max);
+        histogramMap.insert(it.key(), h);
+    }
+
+    QVariantMap map;
+    map.insert(QStringLiteral("Counters"), counterMap);
+    map.insert(QStringLiteral("Histograms"), histogramMap);
+    return map;
+}
+
+QString Metrics::toText() const
+{
+    QString text;
+    QTextStream out(&text);
+
+    QStringList names = counters.keys();
+    names.sort();
+    for (const QString &name : names)
+        out << name << ' ' << counters.value(name) << '\n';
+
+    names = histograms.keys();
+    names.sort();
+    for (const QString &name : names) {
+        const Histogram &h = histograms[name];
+        out << name << " count " << h.count << " sum_us " << h.sum << " max_us " << h.max << '\n';
+        for (int i = 0; i < BucketCount; ++i) {
+            if (!h.buckets[i])
+                continue;
+            out << "  le ";
+            if (bucketBound(i) < 0)
+                out << "inf";
+            else
+                out << bucketBound(i);
+            out << ' ' << h.buckets[i] << '\n';
+        }
+    }
+    return text;
+}
+
+bool Metrics::dumpOnSignal(int signum, const QString &fileName)
+{
+    if (dumpSignal)
+        return false;
+
+    dumpSignal = signum;
+    dumpFileName = fileName;
+    connect(UnixSignalNotifier::instance(), &UnixSignalNotifier::received, this, &Metrics::signalReceived);
+    return UnixSignalNotifier::instance()->watch(signum);
+}
+
+void Metrics::signalReceived(int signum)
+{
+    TRACE_FUNCTION();
+    if (signum != dumpSignal)
+        return;
+
+    QSaveFile file(dumpFileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qCWarning(connAgent) << "Cannot write metrics to" << dumpFileName;
+        return;
+    }
+    file.write(toText().toUtf8());
+    if (file.commit())
+        qCInfo(connAgent) << "Metrics written to" << dumpFileName;
+}
@@ -0,0 +1,71 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QObject>
+#include <QHash>
+#include <QVariantMap>
+
+/*
+ * Always-on counters and latency histograms. Histograms have fixed bucket
+ * bounds from 10 us to 60 s, so recording a value is a hash lookup and an
+ * increment. The registry can be read as a map for D-Bus or written out as
+ * text when a Unix signal is received.
+ */
+class Metrics : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum { BucketCount = 16 };
+
+    explicit Metrics(QObject *parent = 0);
+    ~Metrics();
+
+    void increment(const QString &counter, quint64 amount = 1);
+    void record(const QString &histogram, qint64 usecs);
+
+    quint64 counter(const QString &name) const;
+    QVariantMap toVariantMap() const;
+    QString toText() const;
+
+    // Writes toText() to fileName whenever signum is received
+    bool dumpOnSignal(int signum, const QString &fileName);
+
+    static int bucket(qint64 usecs);
+    static qint64 bucketBound(int index);
+
+private slots:
+    void signalReceived(int signum);
+
+private:
+    struct Histogram {
+        Histogram() : count(0), sum(0), max(0) { for (quint64 &b : buckets) b = 0; }
+
+        quint64 buckets[BucketCount];
+        quint64 count;
+        qint64 sum;
+        qint64 max;
+    };
+
+    QHash<QString, quint64> counters;
+    QHash<QString, Histogram> histograms;
+    int dumpSignal;
+    QString dumpFileName;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,231 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "migrationengine.h"
+
+#include <connman-qt5/networkservice.h>
+
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+static const int EvaluationInterval = 10 * 1000;
+static const int MigrationCooldown = 2 * 60 * 1000;
+
+static bool isStateOnline(NetworkService::ServiceState state)
+{
+    return state == NetworkService::OnlineState || state == NetworkService::ReadyState;
+}
+
+// wired, Bluetooth and VPN connections are never given up for a better score
+static bool isWireless(NetworkService *service)
+{
+    return service->type() == QLatin1String("wifi") || service->type() == QLatin1String("cellular");
+}
+
+MigrationEngine::MigrationEngine(QObject *parent) :
+    QObject(parent),
+    enabled(true),
+    margin(15),
+    dwellTime(30 * 1000),
+    onlineCandidates(0)
+{
+    // only runs while there is something to choose between
+    evaluationTimer.setInterval(EvaluationInterval);
+    connect(&evaluationTimer, &QTimer::timeout, this, &MigrationEngine::evaluationDue);
+}
+
+MigrationEngine::~MigrationEngine()
+{
+}
+
+void MigrationEngine::setEnabled(bool on)
+{
+    enabled = on;
+    challenger.clear();
+    updateTimer();
+}
+
+bool MigrationEngine::isEnabled() const
+{
+    return enabled;
+}
+
+void MigrationEngine::setTechnologyPreference(const QStringList &technologies)
+{
+    techPreference = technologies;
+}
+
+void MigrationEngine::setMargin(int points)
+{
+    margin = points;
+}
+
+void MigrationEngine::setDwellTime(int msecs)
+{
+    dwellTime = msecs;
+}
+
+void MigrationEngine::setQuality(const QString &path, qreal quality)
+{
+    history[path].quality = qBound<qreal>(0, quality, 1);
+}
+
+void MigrationEngine::setSuccessRate(const QString &path, qreal rate)
+{
+    history[path].successRate = qBound<qreal>(0, rate, 1);
+}
+
+void MigrationEngine::retain(const QStringList &paths)
+{
+    for (QHash<QString, History>::iterator it = history.begin(); it != history.end();) {
+        if (paths.contains(it.key()))
+            ++it;
+        else
+            it = history.erase(it);
+    }
+    history.squeeze();
+}
+
+void MigrationEngine::updateCandidates(const QVector<NetworkService *> &services)
+{
+    onlineCandidates = 0;
+    for (NetworkService *service : services) {
+        if (isEligible(service) && isStateOnline(service->serviceState()))
+            onlineCandidates++;
+    }
+    updateTimer();
+}
+
+void MigrationEngine::updateTimer()
+{
+    if (enabled && onlineCandidates > 1) {
+        if (!evaluationTimer.isActive())
+            evaluationTimer.start();
+    } else {
+        evaluationTimer.stop();
+    }
+}
+
+void MigrationEngine::recordState(NetworkService *service, NetworkService::ServiceState state)
+{
+    History &h = history[service->path()];
+
+    switch (state) {
+    case NetworkService::AssociationState:
+    case NetworkService::ConfigurationState:
+        h.attempting = true;
+        break;
+    case NetworkService::ReadyState:
+    case NetworkService::OnlineState:
+        if (h.attempting)
+            h.successRate = 0.75 * h.successRate + 0.25;
+        h.attempting = false;
+        break;
+    case NetworkService::FailureState:
+        h.successRate = 0.75 * h.successRate;
+        h.attempting = false;
+        break;
+    default:
+        h.attempting = false;
+        break;
+    }
+}
+
+int MigrationEngine::score(int techRank, int techCount, uint strength, qreal successRate, qreal quality)
+{
+    // technology preference dominates, the rest decides within and
+    // occasionally across adjacent technologies
+    int techScore = techRank < 0 ? 0 : (techCount - techRank) * 25;
+    return techScore + int(strength) / 2 + int(successRate * 30) + int(quality * 30);
+}
+
+int MigrationEngine::score(NetworkService *service) const
+{
+    const History h = history.value(service->path());
+    // wired links do not report strength
+    uint strength = service->type() == QLatin1String("ethernet") ? 100 : service->strength();
+    return score(techPreference.indexOf(service->type()), techPreference.count(),
+                 strength, h.successRate, h.quality);
+}
+
+bool MigrationEngine::isEligible(NetworkService *service) const
+{
+    return isWireless(service) && service->favorite() && service->autoConnect()
+            && service->serviceState() != NetworkService::FailureState;
+}
+
+bool MigrationEngine::mayReplace(NetworkService *candidate, NetworkService *defaultRoute) const
+{
+    if (candidate->type() == defaultRoute->type())
+        return true;
+
+    // across technologies only towards one connman prefers
+    const int candidateRank = techPreference.indexOf(candidate->type());
+    const int currentRank = techPreference.indexOf(defaultRoute->type());
+    return candidateRank >= 0 && (currentRank < 0 || candidateRank < currentRank);
+}
+
+void MigrationEngine::evaluate(const QVector<NetworkService *> &services, NetworkService *defaultRoute)
+{
+    if (!enabled || !defaultRoute || !isStateOnline(defaultRoute->serviceState()))
+        return;
+
+    // a service without autoconnect is up because the user connected it
+    if (!isEligible(defaultRoute))
+        return;
+
+    if (lastMigration.isValid() && lastMigration.elapsed() < MigrationCooldown)
+        return;
+
+    const int currentScore = score(defaultRoute);
+    NetworkService *best = nullptr;
+    int bestScore = currentScore + margin;
+
+    for (NetworkService *service : services) {
+        if (service == defaultRoute || !isEligible(service) || !mayReplace(service, defaultRoute))
+            continue;
+        int s = score(service);
+        if (s >= bestScore) {
+            best = service;
+            bestScore = s;
+        }
+    }
+
+    if (!best) {
+        if (!challenger.isEmpty())
+            qCDebug(connAgent) << "Migration challenger" << challenger << "fell back";
+        challenger.clear();
+        return;
+    }
+
+    if (best->path() != challenger) {
+        qCDebug(connAgent) << "Migration challenger" << best->path() << bestScore
+                           << "vs" << defaultRoute->path() << currentScore;
+        challenger = best->path();
+        challengerSince.start();
+        return;
+    }
+
+    if (challengerSince.elapsed() < dwellTime)
+        return;
+
+    qCInfo(connAgent) << "Migrating from" << defaultRoute->path() << "score" << currentScore
+                      << "to" << best->path() << "score" << bestScore
+                      << "after" << challengerSince.elapsed() << "ms";
+    challenger.clear();
+    lastMigration.start();
+    Q_EMIT migrate(defaultRoute, best);
+}
@@ -0,0 +1,102 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef MIGRATIONENGINE_H
+#define MIGRATIONENGINE_H
+
+#include <QObject>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+#include "networkservice.h"
+
+/*
+ * Scores known services and decides when moving the default route to a
+ * different service is worth it. A challenger has to beat the current
+ * default route by a margin for the whole dwell time, and after a
+ * migration there is a cooldown, so that short fluctuations in signal
+ * strength do not make the connection flap.
+ *
+ * Only autoconnectable wifi and cellular services take part. A wired,
+ * Bluetooth or VPN default route, or one the user connected by hand, is
+ * never replaced, and a different technology is only chosen when connman's
+ * PreferredTechnologies ranks it higher.
+ */
+class MigrationEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MigrationEngine(QObject *parent = 0);
+    ~MigrationEngine();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    // connman's PreferredTechnologies, most preferred first
+    void setTechnologyPreference(const QStringList &technologies);
+    void setMargin(int points);
+    void setDwellTime(int msecs);
+
+    // Measured connection quality of a service, 0 (unusable) to 1 (good)
+    void setQuality(const QString &path, qreal quality);
+    // Seeds the success rate from persistent history
+    void setSuccessRate(const QString &path, qreal rate);
+    void recordState(NetworkService *service, NetworkService::ServiceState state);
+    // Periodic evaluation only runs while more than one candidate is online
+    void updateCandidates(const QVector<NetworkService *> &services);
+    // Forgets the history of services not in paths
+    void retain(const QStringList &paths);
+
+    int score(NetworkService *service) const;
+    static int score(int techRank, int techCount, uint strength, qreal successRate, qreal quality);
+
+    void evaluate(const QVector<NetworkService *> &services, NetworkService *defaultRoute);
+
+Q_SIGNALS:
+    // Periodic re-evaluation is due, the owner should call evaluate()
+    void evaluationDue();
+    void migrate(NetworkService *from, NetworkService *to);
+
+private:
+    struct History {
+        History() : successRate(0.5), quality(0.5), attempting(false) {}
+
+        qreal successRate;  // smoothed connect outcome, 1 = always succeeds
+        qreal quality;
+        bool attempting;
+    };
+
+    bool isEligible(NetworkService *service) const;
+    bool mayReplace(NetworkService *candidate, NetworkService *defaultRoute) const;
+    void updateTimer();
+
+    bool enabled;
+    QStringList techPreference;
+    int margin;
+    int dwellTime;
+    QHash<QString, History> history;
+    int onlineCandidates;
+
+    QString challenger;
+    QElapsedTimer challengerSince;
+    QElapsedTimer lastMigration;
+    QTimer evaluationTimer;
+};
+
+#endif // MIGRATIONENGINE_H
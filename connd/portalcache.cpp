@@ -0,0 +1,236 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "portalcache.h"
+#include "qualityprober.h"
+
+#include <QLoggingCategory>
+#include <QTcpSocket>
+#include <QTimer>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+static const int CheckTimeout = 5 * 1000;
+// how long after asking for the browser a login is still attributed to it
+static const qint64 LoginWindow = 10 * 60 * 1000;
+static const int MaxResponseSize = 4096;
+
+PortalCache::PortalCache(QObject *parent) :
+    QObject(parent),
+    validity(60 * 60 * 1000),
+    checkUrl(QStringLiteral("http://ipv4.jolla.com/online/status.html")),
+    launched(0),
+    avoided(0),
+    checksFailed(0)
+{
+}
+
+PortalCache::~PortalCache()
+{
+    for (const Check &check : checks)
+        delete check.socket;
+}
+
+void PortalCache::setValidity(int msecs)
+{
+    validity = msecs;
+}
+
+void PortalCache::setCheckUrl(const QUrl &url)
+{
+    checkUrl = url;
+}
+
+void PortalCache::portalRequested(NetworkService *service, const QString &url)
+{
+    const QString path = service->path();
+    if (checks.contains(path))
+        return;
+
+    if (isValid(path)) {
+        startCheck(service, url);
+        return;
+    }
+
+    passed.remove(path);
+    pending[path].start();
+    launched++;
+    Q_EMIT browserNeeded(path, url);
+}
+
+void PortalCache::verify(NetworkService *service)
+{
+    const QString path = service->path();
+    if (checks.contains(path))
+        return;
+
+    startCheck(service, QString(), true);
+}
+
+void PortalCache::recordState(NetworkService *service, NetworkService::ServiceState state)
+{
+    const QString path = service->path();
+    if (state == NetworkService::OnlineState) {
+        QHash<QString, QElapsedTimer>::iterator it = pending.find(path);
+        if (it != pending.end()) {
+            if (it->elapsed() < LoginWindow) {
+                qCDebug(connAgent) << "Portal login on" << path << "cached";
+                passed[path].start();
+            }
+            pending.erase(it);
+        }
+    } else if (state == NetworkService::FailureState) {
+        pending.remove(path);
+    }
+}
+
+bool PortalCache::isValid(const QString &path) const
+{
+    QHash<QString, QElapsedTimer>::const_iterator it = passed.constFind(path);
+    return validity > 0 && it != passed.constEnd() && it->elapsed() < validity;
+}
+
+void PortalCache::retain(const QStringList &paths)
+{
+    for (QHash<QString, QElapsedTimer>::iterator it = passed.begin(); it != passed.end();) {
+        if (paths.contains(it.key()) && isValid(it.key()))
+            ++it;
+        else
+            it = passed.erase(it);
+    }
+    for (QHash<QString, QElapsedTimer>::iterator it = pending.begin(); it != pending.end();) {
+        if (paths.contains(it.key()))
+            ++it;
+        else
+            it = pending.erase(it);
+    }
+    passed.squeeze();
+    pending.squeeze();
+}
+
+QVariantMap PortalCache::statistics() const
+{
+    int valid = 0;
+    for (QHash<QString, QElapsedTimer>::const_iterator it = passed.constBegin(); it != passed.constEnd(); ++it)
+        valid += isValid(it.key()) ? 1 : 0;
+
+    QVariantMap stats;
+    stats.insert(QStringLiteral("ValidLogins"), valid);
+    stats.insert(QStringLiteral("BrowserLaunches"), launched);
+    stats.insert(QStringLiteral("BrowserLaunchesAvoided"), avoided);
+    stats.insert(QStringLiteral("ChecksFailed"), checksFailed);
+    return stats;
+}
+
+void PortalCache::startCheck(NetworkService *service, const QString &url, bool verifyOnly)
+{
+    const QString path = service->path();
+    const QByteArray iface = QualityProber::interfaceOf(service).toLocal8Bit();
+
+    QTcpSocket *socket = new QTcpSocket(this);
+    Check check;
+    check.url = url;
+    check.socket = socket;
+    check.verifyOnly = verifyOnly;
+    checks.insert(path, check);
+
+    // checking over another link would say nothing about this one
+    if (iface.isEmpty() || !QualityProber::bindToInterface(socket, iface)) {
+        checkUnavailable(path);
+        return;
+    }
+
+    connect(socket, &QTcpSocket::connected, this, [this, socket]() {
+        const QByteArray request = "GET " + checkUrl.path(QUrl::FullyEncoded).toLatin1() + " HTTP/1.0\r\n"
+                "Host: " + checkUrl.host().toLatin1() + "\r\n"
+                "Connection: close\r\n\r\n";
+        socket->write(request);
+    });
+    connect(socket, &QTcpSocket::readyRead, this, [this, path, socket]() {
+        QByteArray &response = checks[path].response;
+        response += socket->read(MaxResponseSize - response.size());
+        if (response.contains("\r\n\r\n") || response.size() >= MaxResponseSize)
+            checkDone(path, isOnlineResponse(response));
+    });
+    connect(socket, static_cast<void (QAbstractSocket::*)(QAbstractSocket::SocketError)>(&QAbstractSocket::error),
+            this, [this, path, socket]() {
+        if (checks.value(path).socket == socket)
+            checkDone(path, isOnlineResponse(checks.value(path).response));
+    });
+    QTimer::singleShot(CheckTimeout, socket, [this, path, socket]() {
+        if (checks.value(path).socket == socket)
+            checkDone(path, false);
+    });
+
+    qCDebug(connAgent) << (verifyOnly ? "Checking connectivity on" : "Checking cached portal login on") << path;
+    socket->connectToHost(checkUrl.host(), checkUrl.port(80), QIODevice::ReadWrite, QAbstractSocket::IPv4Protocol);
+}
+
+// The check could not run, which says nothing about the login
+void PortalCache::checkUnavailable(const QString &path)
+{
+    Check check = checks.take(path);
+    delete check.socket;
+
+    // a handover then waits for connman's own online state
+    if (check.verifyOnly)
+        return;
+
+    passed.remove(path);
+    pending[path].start();
+    launched++;
+    Q_EMIT browserNeeded(path, check.url);
+}
+
+void PortalCache::checkDone(const QString &path, bool ok)
+{
+    Check check = checks.take(path);
+    check.socket->disconnect(this);
+    check.socket->abort();
+    check.socket->deleteLater();
+
+    if (check.verifyOnly) {
+        Q_EMIT verified(path, ok);
+        return;
+    }
+
+    if (ok) {
+        avoided++;
+        qCInfo(connAgent) << "Portal login on" << path << "still valid, browser not opened," << avoided << "avoided so far";
+        return;
+    }
+
+    checksFailed++;
+    passed.remove(path);
+    pending[path].start();
+    launched++;
+    Q_EMIT browserNeeded(path, check.url);
+}
+
+bool PortalCache::isOnlineResponse(const QByteArray &response)
+{
+    // a portal answers with a redirect or its own login page, the real
+    // endpoint with 204 or the connman status header
+    int end = response.indexOf("\r\n");
+    if (end < 0)
+        return false;
+
+    const QList<QByteArray> status = response.left(end).split(' ');
+    if (status.count() < 2 || !status.at(0).startsWith("HTTP/"))
+        return false;
+    if (status.at(1) == "204")
+        return true;
+    return status.at(1) == "200" && response.toLower().contains("\r\nx-connman-status: online");
+}
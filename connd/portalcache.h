@@ -0,0 +1,90 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef PORTALCACHE_H
+#define PORTALCACHE_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPointer>
+#include <QStringList>
+#include <QUrl>
+#include <QVariantMap>
+
+#include "networkservice.h"
+
+class QTcpSocket;
+
+/*
+ * Remembers for how long a captive portal login on a service stays valid.
+ * When connman asks for the portal again within that time, a plain HTTP
+ * check is made over the service's own interface first and the browser is
+ * only opened if the check shows the portal is still in the way.
+ */
+class PortalCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PortalCache(QObject *parent = 0);
+    ~PortalCache();
+
+    void setValidity(int msecs);
+    void setCheckUrl(const QUrl &url);
+
+    void portalRequested(NetworkService *service, const QString &url);
+    // Runs the online check on the service's interface, answered with verified()
+    void verify(NetworkService *service);
+    void recordState(NetworkService *service, NetworkService::ServiceState state);
+    bool isValid(const QString &path) const;
+    // Drops expired logins and services not in paths
+    void retain(const QStringList &paths);
+
+    QVariantMap statistics() const;
+
+Q_SIGNALS:
+    void browserNeeded(const QString &servicePath, const QString &url);
+    void verified(const QString &servicePath, bool online);
+
+private:
+    struct Check {
+        Check() : socket(nullptr), verifyOnly(false) {}
+
+        QString url;
+        QTcpSocket *socket;
+        bool verifyOnly;
+        QByteArray response;
+    };
+
+    void startCheck(NetworkService *service, const QString &url, bool verifyOnly = false);
+    void checkUnavailable(const QString &path);
+    void checkDone(const QString &path, bool passed);
+    static bool isOnlineResponse(const QByteArray &response);
+
+    int validity;
+    QUrl checkUrl;
+    // services waiting for the user to get through the portal
+    QHash<QString, QElapsedTimer> pending;
+    // time of the last successful login per service
+    QHash<QString, QElapsedTimer> passed;
+    QHash<QString, Check> checks;
+
+    quint32 launched;
+    quint32 avoided;
+    quint32 checksFailed;
+};
+
+#endif // PORTALCACHE_H
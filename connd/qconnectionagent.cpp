@@ -15,18 +15,54 @@
 
 #include "qconnectionagent.h"
 #include "connectiond_adaptor.h"
+#include "tetheringstatemachine.h"
+#include "trafficsampler.h"
+#include "uplinkselector.h"
+#include "migrationengine.h"
+#include "servicehistory.h"
+#include "connectrace.h"
+#include "celllocator.h"
+#include "scanpredictor.h"
+#include "handovercontroller.h"
+#include "qualityprober.h"
+#include "portalcache.h"
+#include "credentialprovider.h"
+#include "retryscheduler.h"
+#include "ethernetpowersave.h"
+#include "sleepwatcher.h"
+#include "metrics.h"
+#include "lagmonitor.h"
+#include "startuptimings.h"
+#include "warmsnapshot.h"
+#include "agentconfig.h"
+#include "connmanconfig.h"
+#include "idlereclaimer.h"
+#include "eventjournal.h"
+#include "tracing.h"
+#include "logsink.h"
+#include "unixsignalnotifier.h"
 
 #include <connman-qt5/useragent.h>
 #include <connman-qt5/networktechnology.h>
 #include <connman-qt5/networkservice.h>
 
 #include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusMessage>
+#include <QtDBus/QDBusPendingCallWatcher>
+#include <QtDBus/QDBusPendingReply>
 
+#include <QDateTime>
 #include <QObject>
-#include <QSettings>
+#include <QStandardPaths>
+#include <QUrl>
+
+#include <signal.h>
 
 #define CONND_SERVICE "com.jolla.Connectiond"
 #define CONND_PATH "/Connectiond"
+
+// a snapshot older than this is not worth trusting
+static const qint64 MaxSnapshotAge = 10 * 60 * 1000;
 #define CONND_SESSION_PATH = "/ConnectionSession"
 
 Q_LOGGING_CATEGORY(connAgent, "org.sailfishos.connectionagent", QtWarningMsg)
@@ -41,6 +77,55 @@ static bool isStateOnline(NetworkService::ServiceState state)
     return state == NetworkService::OnlineState || state == NetworkService::ReadyState;
 }
 
+static QString stateName(NetworkService::ServiceState state)
+{
+    switch (state) {
+    case NetworkService::IdleState: return QStringLiteral("idle");
+    case NetworkService::FailureState: return QStringLiteral("failure");
+    case NetworkService::AssociationState: return QStringLiteral("association");
+    case NetworkService::ConfigurationState: return QStringLiteral("configuration");
+    case NetworkService::ReadyState: return QStringLiteral("ready");
+    case NetworkService::DisconnectState: return QStringLiteral("disconnect");
+    case NetworkService::OnlineState: return QStringLiteral("online");
+    }
+    return QStringLiteral("unknown");
+}
+
+// connman's service errors get a counter each, anything else is "other"
+enum ConnmanError {
+    OutOfRangeError,
+    PinMissingError,
+    DhcpFailedError,
+    ConnectFailedError,
+    LoginFailedError,
+    AuthFailedError,
+    InvalidKeyError,
+    BlockedError,
+    OnlineCheckFailedError,
+    OtherError,
+    ConnmanErrorCount
+};
+
+static const QString &errorCounter(const QString &error)
+{
+    static const char *const names[ConnmanErrorCount] = {
+        "out-of-range", "pin-missing", "dhcp-failed", "connect-failed", "login-failed",
+        "auth-failed", "invalid-key", "blocked", "online-check-failed", "other"
+    };
+    static const QVector<QString> counters = [] {
+        QVector<QString> counters;
+        for (const char *name : names)
+            counters << QStringLiteral("errors.") + QLatin1String(name);
+        return counters;
+    }();
+
+    for (int i = 0; i < OtherError; ++i) {
+        if (error == QLatin1String(names[i]))
+            return counters.at(i);
+    }
+    return counters.at(OtherError);
+}
+
 QConnectionAgent::QConnectionAgent(QObject *parent) :
     QObject(parent),
     ua(nullptr),
@@ -48,12 +133,41 @@ QConnectionAgent::QConnectionAgent(QObject *parent) :
     isEthernet(false),
     tetheringWifiTech(nullptr),
     tetheringBtTech(nullptr),
-    tetherWifiWhenPowered(false),
+    wifiTethering(new TetheringStateMachine(this)),
+    tetheringTraffic(new TrafficSampler(this)),
+    qualityProber(new QualityProber(this)),
+    uplinkSelector(new UplinkSelector(qualityProber, this)),
+    migrationEngine(new MigrationEngine(this)),
+    serviceHistory(new ServiceHistory(QString(), this)),
+    connectRace(new ConnectRace(this)),
+    connectRacing(false),
+    connectRaceCandidates(3),
+    connectRaceConcurrency(2),
+    cellLocator(new CellLocator(this)),
+    scanPredictor(new ScanPredictor(QString(), this)),
+    handover(new HandoverController(this)),
+    portalCache(new PortalCache(this)),
+    credentialProvider(new CredentialProvider(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+                                              + QStringLiteral("/credentials.ini"), this)),
+    retryScheduler(new RetryScheduler(this)),
+    ethernetPowerSave(new EthernetPowerSave(this)),
+    sleepWatcher(new SleepWatcher(this)),
+    metrics(new Metrics(this)),
+    lagMonitor(new LagMonitor(metrics, this)),
+    config(new AgentConfig(QStringLiteral("Connectionagent"), QString(), this)),
+    connmanConfig(new ConnmanConfig(QStringLiteral("/etc/connman/main.conf"), this)),
+    idleReclaimer(new IdleReclaimer(this)),
+    scanTimeRemaining(-1),
+    flightModeTimeRemaining(-1),
     tetherBtWhenPowered(false),
     flightModeSuppression(false),
     scanTimeoutInterval(1),
-    valid(true)
+    valid(true),
+    connmanSetUp(false),
+    connmanLost(false)
 {
+    StartupTimings::Phase phase("agent");
+    StartupTimings::instance()->begin("dbus");
     new ConnAdaptor(this);
     QDBusConnection dbus = QDBusConnection::sessionBus();
 
@@ -66,40 +180,62 @@ QConnectionAgent::QConnectionAgent(QObject *parent) :
         qCCritical(connAgent) << "QConnectionAgent: could not register service" << CONND_SERVICE;
         valid = false;
     }
+    StartupTimings::instance()->end("dbus");
+
+    // answer connman agent requests before anything is enumerated
+    setupUserAgent();
 
     connect(this, &QConnectionAgent::configurationNeeded, this, &QConnectionAgent::openConnectionDialog);
+    connect(wifiTethering, &TetheringStateMachine::finished,
+            this, &QConnectionAgent::wifiTetheringBringUpFinished);
+    connect(tetheringTraffic, &TrafficSampler::idle, this, &QConnectionAgent::wifiTetheringIdle);
+    connect(uplinkSelector, &UplinkSelector::uplinkChanged, this, &QConnectionAgent::tetheringUplinkChanged);
+    connect(migrationEngine, &MigrationEngine::evaluationDue, this, &QConnectionAgent::evaluateMigration);
+    connect(migrationEngine, &MigrationEngine::migrate, this, &QConnectionAgent::migrateService);
+    connect(connectRace, &ConnectRace::finished, this, &QConnectionAgent::connectRaceFinished);
+    connect(cellLocator, &CellLocator::cellChanged, scanPredictor, &ScanPredictor::setCell);
+    connect(scanPredictor, &ScanPredictor::scanSuggested, this, &QConnectionAgent::predictedScan);
+    connect(qualityProber, &QualityProber::measured, this, &QConnectionAgent::serviceQualityMeasured);
+    connect(portalCache, &PortalCache::browserNeeded, this, &QConnectionAgent::openPortalBrowser);
+    connect(portalCache, &PortalCache::verified, this, &QConnectionAgent::handoverVerified);
+    connect(retryScheduler, &RetryScheduler::retryDue, this, &QConnectionAgent::retryService);
+    connect(ethernetPowerSave, &EthernetPowerSave::resumed, this, &QConnectionAgent::ethernetLost);
+    connect(sleepWatcher, &SleepWatcher::aboutToSleep, this, &QConnectionAgent::prepareForSleep);
+    connect(sleepWatcher, &SleepWatcher::resumed, this, &QConnectionAgent::resumeFromSleep);
+    connect(config, &AgentConfig::changed, this, &QConnectionAgent::applySettings);
+    connect(connmanConfig, &ConnmanConfig::changed, this, &QConnectionAgent::applyConnmanConfig);
+    connect(idleReclaimer, &IdleReclaimer::idle, this, &QConnectionAgent::enterIdleMode);
+    connect(idleReclaimer, &IdleReclaimer::active, this, &QConnectionAgent::leaveIdleMode);
+    connect(idleReclaimer, &IdleReclaimer::pressure, this, &QConnectionAgent::memoryPressure);
+    if (!idleReclaimer->watchPressure())
+        qCDebug(connAgent) << "No memory pressure information";
+    metrics->dumpOnSignal(SIGUSR1, QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation)
+                          + QStringLiteral("/connectionagent-metrics.txt"));
+    connect(UnixSignalNotifier::instance(), &UnixSignalNotifier::received, this, &QConnectionAgent::unixSignalReceived);
+    UnixSignalNotifier::instance()->watch(SIGUSR2);
 
     connect(netman.data(), &NetworkManager::availabilityChanged, this, &QConnectionAgent::connmanAvailabilityChanged);
     connect(netman.data(), &NetworkManager::servicesListChanged, this, &QConnectionAgent::servicesListChanged);
     connect(netman.data(), &NetworkManager::globalStateChanged, this, &QConnectionAgent::networkManagerStateChanged);
+    connect(netman.data(), &NetworkManager::defaultRouteChanged, this, &QConnectionAgent::updateEthernetPowerSave);
     connect(netman.data(), &NetworkManager::offlineModeChanged, this, &QConnectionAgent::offlineModeChanged);
     connect(netman.data(), &NetworkManager::servicesChanged, this, &QConnectionAgent::updateServices);
     connect(netman.data(), &NetworkManager::technologiesChanged, this, &QConnectionAgent::techChanged);
 
-    QFile connmanConf("/etc/connman/main.conf");
-    if (connmanConf.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        while (!connmanConf.atEnd()) {
-            QString line = connmanConf.readLine();
-            if (line.startsWith("DefaultAutoConnectTechnologies")) {
-                QString token = line.section(" = ", 1, 1).simplified();
-                techPreferenceList = token.split(",");
-                break;
-            }
-        }
-        connmanConf.close();
-    }
-    if (techPreferenceList.isEmpty()) {
-        //ethernet,bluetooth,cellular,wifi is default
-        techPreferenceList << "bluetooth" << "wifi" << "cellular" << "ethernet";
-    }
-
-    bool connmanAvailable = QDBusConnection::systemBus().interface()->isServiceRegistered("net.connman");
-
     scanTimer = new QTimer(this);
     connect(scanTimer, &QTimer::timeout, this, &QConnectionAgent::scanTimeout);
     scanTimer->setSingleShot(true);
-    if (connmanAvailable && valid)
-        setup();
+
+    flightModeTimer = new QTimer(this);
+    connect(flightModeTimer, &QTimer::timeout, this, &QConnectionAgent::flightModeDialogSuppressionTimeout);
+    flightModeTimer->setSingleShot(true);
+    flightModeTimer->setInterval(5 * 1000 * 60); //5 minutes
+
+    // everything else waits for the event loop, so D-Bus calls are served meanwhile
+    if (valid) {
+        StartupTimings::instance()->begin("eventloop");
+        QTimer::singleShot(0, this, &QConnectionAgent::discoverConnman);
+    }
 }
 
 QConnectionAgent::~QConnectionAgent()
@@ -114,12 +250,16 @@ bool QConnectionAgent::isValid() const
 // from useragent
 void QConnectionAgent::onErrorReported(const QString &servicePath, const QString &error)
 {
+    TRACE_FUNCTION();
+    EventJournal::record(EventJournal::Error, servicePath, EventJournal::intern(error));
     if (shouldSuppressError(error, servicePath.contains("cellular")))
         return;
+    metrics->increment(errorCounter(error));
 
     if (!tetheringWifiTech && !tetheringBtTech) return;
     // Suppress errors when switching to tethering mode
-    if ((tetherWifiWhenPowered || tetheringWifiTech->tethering()) && servicePath.contains(QStringLiteral("wifi")))
+    if ((wifiTethering->isStarting() || (tetheringWifiTech && tetheringWifiTech->tethering()))
+            && servicePath.contains(QStringLiteral("wifi")))
         return;
 
     qCWarning(connAgent) << "ConnectionAgent error in" << servicePath << ":" << error;
@@ -129,23 +269,58 @@ void QConnectionAgent::onErrorReported(const QString &servicePath, const QString
 // from useragent
 void QConnectionAgent::onConnectionRequest()
 {
+    TRACE_FUNCTION();
+    idleReclaimer->activity();
+    QElapsedTimer decisionClock;
+    decisionClock.start();
+    metrics->increment(QStringLiteral("connection_requests"));
+
     sendConnectReply("Suppress", 15);
     qCDebug(connAgent) << flightModeSuppression;
     bool okToRequest = true;
     for (Service elem: orderedServicesList) {
         qCDebug(connAgent) << "checking" << elem.service->name() << elem.service->autoConnect();
-        if (elem.service->autoConnect()) {
+        if (elem.service->autoConnect() && !retryScheduler->isQuarantined(elem.path)) {
             okToRequest = false;
             break;
         }
     }
+    if (orderedServicesList.isEmpty()) {
+        // just restarted and not enumerated yet, go by what was known before
+        for (const WarmSnapshot::Service &elem : warmSnapshot.services) {
+            if (elem.autoConnect && !retryScheduler->isQuarantined(elem.path)) {
+                okToRequest = false;
+                break;
+            }
+        }
+    }
     if (!flightModeSuppression && okToRequest) {
+        metrics->increment(QStringLiteral("connection_requests.dialog"));
+        EventJournal::record(EventJournal::ConnectionRequest, 0, 1);
         Q_EMIT connectionRequest();
+    } else {
+        EventJournal::record(EventJournal::ConnectionRequest, 0, 0);
     }
+    metrics->record(QStringLiteral("connection_request_decision"), decisionClock.nsecsElapsed() / 1000);
 }
 
 void QConnectionAgent::onBrowserRequested(const QString &servicePath, const QString &url)
 {
+    TRACE_FUNCTION();
+    idleReclaimer->activity();
+    EventJournal::record(EventJournal::Browser, servicePath, 0);
+    int index = orderedServicesList.indexOf(servicePath);
+    if (index < 0) {
+        openPortalBrowser(servicePath, url);
+        return;
+    }
+    portalCache->portalRequested(orderedServicesList.at(index).service, url);
+}
+
+void QConnectionAgent::openPortalBrowser(const QString &servicePath, const QString &url)
+{
+    TRACE_FUNCTION();
+    EventJournal::record(EventJournal::Browser, servicePath, 1);
     QString serviceName;
     for (const Service &elem : orderedServicesList) {
         if (elem.service->path() == servicePath) {
@@ -158,17 +333,41 @@ void QConnectionAgent::onBrowserRequested(const QString &servicePath, const QStr
 
 void QConnectionAgent::sendConnectReply(const QString &in0, int in1)
 {
-    ua->sendConnectReply(in0, in1);
+    TRACE_FUNCTION();
+    TRACE_CALL("sendConnectReply", ua->sendConnectReply(in0, in1));
+}
+
+void QConnectionAgent::onUserInputRequested(const QString &servicePath, const QVariantMap &fields)
+{
+    TRACE_FUNCTION();
+    idleReclaimer->activity();
+    QVariantMap reply;
+    if (credentialProvider->answer(servicePath, fields, &reply)) {
+        EventJournal::record(EventJournal::UserInput, servicePath, 1);
+        TRACE_CALL("sendUserReply", ua->sendUserReply(reply));
+        return;
+    }
+    EventJournal::record(EventJournal::UserInput, servicePath, 0);
+
+    userInputClock.start();
+    Q_EMIT userInputRequested(servicePath, fields);
 }
 
 void QConnectionAgent::sendUserReply(const QVariantMap &input)
 {
+    TRACE_FUNCTION();
+    idleReclaimer->activity();
     qCDebug(connAgent) << Q_FUNC_INFO;
-    ua->sendUserReply(input);
+    if (userInputClock.isValid()) {
+        credentialProvider->uiAnswered(userInputClock.elapsed());
+        userInputClock.invalidate();
+    }
+    TRACE_CALL("sendUserReply", ua->sendUserReply(input));
 }
 
 void QConnectionAgent::servicesListChanged(const QStringList &list)
 {
+    TRACE_FUNCTION();
     bool changed = false;
 
     for (const QString &path: list) {
@@ -196,25 +395,47 @@ void QConnectionAgent::servicesListChanged(const QStringList &list)
 
 void QConnectionAgent::serviceErrorChanged(const QString &error)
 {
+    TRACE_FUNCTION();
     NetworkService *service = static_cast<NetworkService *>(sender());
+    EventJournal::record(EventJournal::Error, service->path(), EventJournal::intern(error));
     if (shouldSuppressError(error, service->type() == QLatin1String("cellular")))
         return;
+    metrics->increment(errorCounter(error));
 
     Q_EMIT errorReported(service->path(), error);
 }
 
 void QConnectionAgent::serviceStateChanged(NetworkService::ServiceState state)
 {
+    TRACE_FUNCTION();
+    idleReclaimer->activity();
     NetworkService *service = static_cast<NetworkService *>(sender());
     if (!service)
         return;
 
     qCDebug(connAgent) << state << service->name() << service->strength();
+    migrationEngine->recordState(service, state);
+    migrationEngine->updateCandidates(netman->getServices());
+    serviceHistory->recordState(service, state);
+    portalCache->recordState(service, state);
+    credentialProvider->recordState(service, state);
+    retryScheduler->recordState(service, state);
+    recordStateMetrics(service, state);
 
     if (state == NetworkService::ReadyState && service->type() == "wifi"
-            && !tetherWifiWhenPowered
+            && !wifiTethering->isStarting()
             && netman->defaultRoute()->type() == "cellular") {
-        netman->defaultRoute()->requestDisconnect();
+        handover->begin(service, netman->defaultRoute());
+        // a portal completes any TCP connect, only real content proves the link
+        portalCache->verify(service);
+        qualityProber->probe(service->path(), QualityProber::interfaceOf(service));
+    }
+
+    if (state == NetworkService::OnlineState) {
+        qualityProber->watch(service);
+    } else if (state == NetworkService::IdleState || state == NetworkService::FailureState
+               || state == NetworkService::DisconnectState) {
+        qualityProber->unwatch(service->path());
     }
 
     if (state == NetworkService::DisconnectState) {
@@ -227,36 +448,26 @@ void QConnectionAgent::serviceStateChanged(NetworkService::ServiceState state)
         return;
     }
     if (state == NetworkService::DisconnectState) {
-        ua->sendConnectReply("Clear");
+        TRACE_CALL("sendConnectReply", ua->sendConnectReply("Clear"));
     }
-    if (state == NetworkService::FailureState) {
-        if (tetherWifiWhenPowered && service->type() == "cellular" && tetheringWifiTech->tethering()) {
-            Q_EMIT wifiTetheringFinished(false);
-        }
+
+    // tethering takes over the wifi interface, keep the station side off it
+    if (wifiTethering->isStarting() && service->type() == "wifi" && state == NetworkService::AssociationState) {
+        EventJournal::request(EventJournal::Disconnect, service->path());
+        TRACE_CALL("requestDisconnect", service->requestDisconnect());
     }
 
-    if (tetherWifiWhenPowered && service->type() == "wifi" && state == NetworkService::AssociationState) {
-        service->requestDisconnect();
+    // one-off networks are not worth a scan when coming back
+    if (state == NetworkService::ReadyState && service->type() == "wifi"
+            && service->favorite() && service->autoConnect()) {
+        scanPredictor->learn(service->path());
     }
 
     if (state == NetworkService::OnlineState) {
         Q_EMIT connectionState(QStringLiteral("online"), service->type());
-
-        if (service->type() == "wifi" && tetherWifiWhenPowered) {
-            netman->getTechnology(service->type())->setTethering(true);
-        }
-        if (service->type() == "cellular" && tetherWifiWhenPowered) {
-            if (!tetheringWifiTech->tethering()) {
-                tetheringWifiTech->setTethering(true);
-            }
-        }
     }
     // auto migrate
-    if (state == NetworkService::IdleState) {
-        if (service->type() == "wifi" && tetherWifiWhenPowered) {
-            netman->getTechnology(service->type())->setTethering(true);
-        }
-    } else {
+    if (state != NetworkService::IdleState) {
         updateServices();
     }
 }
@@ -264,6 +475,8 @@ void QConnectionAgent::serviceStateChanged(NetworkService::ServiceState state)
 // from plugin/qml
 void QConnectionAgent::connectToType(const QString &type)
 {
+    TRACE_FUNCTION();
+    idleReclaimer->activity();
     if (netman->technologyPathForType(type).isEmpty()) {
         Q_EMIT errorReported("", "Type not valid");
         return;
@@ -280,13 +493,12 @@ void QConnectionAgent::connectToType(const QString &type)
     }
 
     bool found = false;
+    QVector<NetworkService *> candidates;
     for (Service elem : orderedServicesList) {
         if (elem.path.contains(convType)) {
             if (!isStateOnline(elem.service->serviceState())) {
-                if (elem.service->autoConnect()) {
-                    qCDebug(connAgent) << "<<<<<<<<<<< requestConnect() >>>>>>>>>>>>";
-                    elem.service->requestConnect();
-                    return;
+                if (elem.service->autoConnect() && !retryScheduler->isQuarantined(elem.path)) {
+                    candidates << elem.service;
                 } else if (!elem.path.contains("cellular")) {
                     // ignore cellular that are not on autoconnect
                     found = true;
@@ -297,6 +509,22 @@ void QConnectionAgent::connectToType(const QString &type)
         }
     }
 
+    if (!candidates.isEmpty()) {
+        // try the one that has historically come up fastest first
+        serviceHistory->sortByExpectedOnlineTime(&candidates);
+        if (connectRacing && candidates.count() > 1) {
+            // a wifi radio associates with one network at a time, there the
+            // stagger acts as a fallback timeout instead
+            connectRace->start(candidates.mid(0, connectRaceCandidates),
+                               convType == "wifi" ? 1 : connectRaceConcurrency);
+            return;
+        }
+        qCDebug(connAgent) << "<<<<<<<<<<< requestConnect() >>>>>>>>>>>>" << candidates.first()->path();
+        EventJournal::request(EventJournal::Connect, candidates.first()->path());
+        TRACE_CALL("requestConnect", candidates.first()->requestConnect());
+        return;
+    }
+
     // Can't connect to the service of a type that doesn't exist
     if (!found)
         return;
@@ -308,9 +536,127 @@ void QConnectionAgent::connectToType(const QString &type)
     Q_EMIT configurationNeeded(convType);
 }
 
+QVariantMap QConnectionAgent::connectionHistory() const
+{
+    TRACE_FUNCTION();
+    return serviceHistory->toVariantMap();
+}
+
+QVariantMap QConnectionAgent::scanPredictionStatistics() const
+{
+    TRACE_FUNCTION();
+    return scanPredictor->statistics();
+}
+
+QVariantMap QConnectionAgent::handoverStatistics() const
+{
+    TRACE_FUNCTION();
+    return handover->statistics();
+}
+
+QVariantMap QConnectionAgent::serviceQuality() const
+{
+    TRACE_FUNCTION();
+    return qualityProber->toVariantMap();
+}
+
+QVariantMap QConnectionAgent::portalStatistics() const
+{
+    TRACE_FUNCTION();
+    return portalCache->statistics();
+}
+
+QVariantMap QConnectionAgent::credentialStatistics() const
+{
+    TRACE_FUNCTION();
+    return credentialProvider->statistics();
+}
+
+QVariantMap QConnectionAgent::serviceQuarantine() const
+{
+    TRACE_FUNCTION();
+    return retryScheduler->toVariantMap();
+}
+
+void QConnectionAgent::releaseQuarantine(const QString &servicePath)
+{
+    TRACE_FUNCTION();
+    retryScheduler->release(servicePath);
+}
+
+QVariantMap QConnectionAgent::ethernetPowerSaveStatistics() const
+{
+    TRACE_FUNCTION();
+    return ethernetPowerSave->statistics();
+}
+
+QVariantMap QConnectionAgent::resumeStatistics() const
+{
+    TRACE_FUNCTION();
+    return sleepWatcher->statistics();
+}
+
+QVariantMap QConnectionAgent::GetMetrics() const
+{
+    TRACE_FUNCTION();
+    return metrics->toVariantMap();
+}
+
+QVariantMap QConnectionAgent::eventLoopLag() const
+{
+    TRACE_FUNCTION();
+    QVariantMap lag = lagMonitor->statistics();
+    const QVariantMap histograms = metrics->toVariantMap().value(QStringLiteral("Histograms")).toMap();
+    lag.insert(QStringLiteral("Histogram"), histograms.value(QStringLiteral("event_loop_lag")));
+    return lag;
+}
+
+QVariantMap QConnectionAgent::startupTimings() const
+{
+    TRACE_FUNCTION();
+    return StartupTimings::instance()->toVariantMap();
+}
+
+QByteArray QConnectionAgent::DumpJournal() const
+{
+    TRACE_FUNCTION();
+    return EventJournal::dump();
+}
+
+QString QConnectionAgent::DumpTrace() const
+{
+    return QString::fromUtf8(Tracing::toJson());
+}
+
+void QConnectionAgent::setLoggingRules(const QString &rules)
+{
+    TRACE_FUNCTION();
+    LogSink::instance()->setFilterRules(rules);
+    qCInfo(connAgent) << "Logging rules set to" << rules;
+}
+
+QVariantMap QConnectionAgent::loggingStatus() const
+{
+    QVariantMap status;
+    status.insert(QStringLiteral("Rules"), LogSink::instance()->filterRules());
+    status.insert(QStringLiteral("Output"), LogSink::instance()->isOutputEnabled());
+    status.insert(QStringLiteral("Dropped"), LogSink::instance()->dropped());
+    return status;
+}
+
+QVariantMap QConnectionAgent::idleStatistics() const
+{
+    TRACE_FUNCTION();
+    return idleReclaimer->statistics();
+}
+
 void QConnectionAgent::updateServices()
 {
+    TRACE_FUNCTION();
     qCDebug(connAgent) << Q_FUNC_INFO;
+    QElapsedTimer updateClock;
+    updateClock.start();
+    metrics->increment(QStringLiteral("update_services"));
     ServiceList oldServices = orderedServicesList;
     orderedServicesList.clear();
 
@@ -326,11 +672,16 @@ void QConnectionAgent::updateServices()
             elem.path = servicePath;
             elem.service = serv;
             orderedServicesList << elem;
+            serviceHistory->seen(servicePath);
 
             if (!oldServices.contains(servicePath)) {
                 //new!
                 qCInfo(connAgent) << "New service:" << servicePath;
 
+                qreal successRate = serviceHistory->successRate(servicePath);
+                if (successRate >= 0)
+                    migrationEngine->setSuccessRate(servicePath, successRate);
+
                 QObject::connect(serv, &NetworkService::serviceStateChanged,
                                  this, &QConnectionAgent::serviceStateChanged, Qt::UniqueConnection);
                 QObject::connect(serv, &NetworkService::connectRequestFailed,
@@ -339,13 +690,18 @@ void QConnectionAgent::updateServices()
                                  this, &QConnectionAgent::servicesError, Qt::UniqueConnection);
                 QObject::connect(serv, &NetworkService::autoConnectChanged,
                                  this, &QConnectionAgent::serviceAutoconnectChanged, Qt::UniqueConnection);
+                QObject::connect(serv, &NetworkService::strengthChanged,
+                                 this, &QConnectionAgent::evaluateMigration, Qt::UniqueConnection);
             }
         }
     }
+    migrationEngine->updateCandidates(netman->getServices());
+    metrics->record(QStringLiteral("update_services"), updateClock.nsecsElapsed() / 1000);
 }
 
 void QConnectionAgent::servicesError(const QString &errorMessage)
 {
+    TRACE_FUNCTION();
     if (errorMessage.isEmpty())
         return;
     NetworkService *serv = static_cast<NetworkService *>(sender());
@@ -355,68 +711,214 @@ void QConnectionAgent::servicesError(const QString &errorMessage)
 
 void QConnectionAgent::networkManagerStateChanged(NetworkManager::State state)
 {
+    TRACE_FUNCTION();
+    idleReclaimer->activity();
     qCInfo(connAgent) << "Network state:" << state;
+    EventJournal::record(EventJournal::GlobalState, 0, EventJournal::intern(netman->state()));
+    handover->globalStateChanged(isStateOnline(state));
+    if (isStateOnline(state))
+        sleepWatcher->online();
+    updateEthernetPowerSave();
 
     if ((state == NetworkManager::OnlineState && netman->defaultRoute()->type() == "cellular")
             || (state == NetworkManager::IdleState)) {
 
         if (tetheringWifiTech && tetheringWifiTech->powered()
-                && !tetheringWifiTech->tethering())
-                tetheringWifiTech->scan();
+                && !tetheringWifiTech->tethering()) {
+            EventJournal::request(EventJournal::Scan, tetheringWifiTech->type());
+            TRACE_CALL("scan", tetheringWifiTech->scan());
+        }
         // on gprs, scan wifi every scanTimeoutInterval minutes
         if (scanTimeoutInterval != 0)
             scanTimer->start(scanTimeoutInterval * 60 * 1000);
     }
-
-    if (tetherWifiWhenPowered && state == NetworkManager::OnlineState) {
-
-        if (tetheringWifiTech->tethering()) {
-            if (netman->defaultRoute()->type() == "cellular") {
-                tetherWifiWhenPowered = false;
-                Q_EMIT wifiTetheringFinished(true);
-            }
-        } else {
-            tetheringWifiTech->setTethering(true);
-        }
-    }
 }
 
 void QConnectionAgent::connmanAvailabilityChanged(bool available)
 {
-    if (available) {
-        setup();
+    TRACE_FUNCTION();
+    if (!available) {
+        connmanSetUp = false;
+        connmanLost = true;
+        return;
     }
+
+    if (connmanSetUp)
+        return;
+    if (connmanLost) {
+        // connman restarted, start over with a new agent
+        setupUserAgent();
+        connmanLost = false;
+    }
+    setup();
 }
 
-void QConnectionAgent::setup()
+void QConnectionAgent::setupUserAgent()
 {
-    qCDebug(connAgent) << Q_FUNC_INFO << netman->globalState();
+    TRACE_FUNCTION();
+    StartupTimings::Phase phase("useragent");
     delete ua;
     ua = new UserAgent(this);
 
     connect(ua, &UserAgent::connectionRequest, this, &QConnectionAgent::onConnectionRequest);
     connect(ua, &UserAgent::errorReported, this, &QConnectionAgent::onErrorReported);
     connect(ua, &UserAgent::userInputCanceled, this, &QConnectionAgent::userInputCanceled);
-    connect(ua, &UserAgent::userInputRequested, this, &QConnectionAgent::userInputRequested);
+    connect(ua, &UserAgent::userInputRequested, this, &QConnectionAgent::onUserInputRequested);
     connect(ua, &UserAgent::browserRequested, this, &QConnectionAgent::onBrowserRequested);
+}
+
+void QConnectionAgent::discoverConnman()
+{
+    TRACE_FUNCTION();
+    StartupTimings::instance()->end("eventloop");
+
+    // the lookup goes out first so its round trip overlaps the rest
+    StartupTimings::instance()->begin("connman");
+    QDBusMessage message = QDBusMessage::createMethodCall(QStringLiteral("org.freedesktop.DBus"),
+                                                          QStringLiteral("/org/freedesktop/DBus"),
+                                                          QStringLiteral("org.freedesktop.DBus"),
+                                                          QStringLiteral("NameHasOwner"));
+    message << QStringLiteral("net.connman");
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(
+                QDBusConnection::systemBus().asyncCall(message), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, &QConnectionAgent::connmanDiscovered);
+
+    // the disk is only read once the D-Bus name is taken
+    StartupTimings::instance()->begin("config");
+    config->load();
+    StartupTimings::instance()->end("config");
+
+    StartupTimings::instance()->begin("snapshot");
+    restoreSnapshot();
+    StartupTimings::instance()->end("snapshot");
+
+    StartupTimings::instance()->begin("history");
+    serviceHistory->load();
+    StartupTimings::instance()->end("history");
+
+    StartupTimings::instance()->begin("cells");
+    scanPredictor->load();
+    StartupTimings::instance()->end("cells");
+
+    readConnmanConf();
+
+    // match rules are added with blocking calls, so not before the event loop runs
+    StartupTimings::Phase phase("watchers");
+    sleepWatcher->watchLogind();
+    cellLocator->watchOfono();
+    connmanConfig->watch();
+    config->watch();
+}
+
+void QConnectionAgent::connmanDiscovered(QDBusPendingCallWatcher *watcher)
+{
+    TRACE_FUNCTION();
+    watcher->deleteLater();
+    StartupTimings::instance()->end("connman");
+
+    QDBusPendingReply<bool> reply = *watcher;
+    if (reply.isError()) {
+        qCWarning(connAgent) << "Cannot look up connman:" << reply.error().message();
+        return;
+    }
+    // until NetworkManager has fetched connman's properties, setup() is left
+    // to its availabilityChanged(true)
+    if (reply.value() && netman->isAvailable() && !connmanSetUp)
+        setup();
+}
+
+void QConnectionAgent::readConnmanConf()
+{
+    StartupTimings::Phase phase("mainconf");
+    connmanConfig->load();
+    applyConnmanConfig();
+}
+
+void QConnectionAgent::applyConnmanConfig()
+{
+    TRACE_FUNCTION();
+    // connman's preferred technologies first, then the rest it autoconnects
+    QStringList preference = connmanConfig->preferredTechnologies();
+    for (const QString &tech : connmanConfig->defaultAutoConnectTechnologies()) {
+        if (!preference.contains(tech))
+            preference << tech;
+    }
+    if (preference.isEmpty()) {
+        //ethernet,bluetooth,cellular,wifi is default
+        preference << "bluetooth" << "wifi" << "cellular" << "ethernet";
+    }
+
+    alwaysConnectedTechnologies = connmanConfig->alwaysConnectedTechnologies();
+    applyAlwaysConnected();
+    setTechnologyPreference(preference);
+    // only connman's own preference order may move the default route across technologies
+    migrationEngine->setTechnologyPreference(connmanConfig->preferredTechnologies());
+}
+
+void QConnectionAgent::applyAlwaysConnected()
+{
+    // connman keeps these up next to the default route, so must the agent
+    const bool keepCellular = alwaysConnectedTechnologies.contains(QStringLiteral("cellular"));
+    ethernetPowerSave->setParkCellular(!keepCellular && config->value("ethernetParkCellular", true).toBool());
+    handover->setKeepCellular(keepCellular);
+}
+
+void QConnectionAgent::setTechnologyPreference(const QStringList &preference)
+{
+    if (preference == techPreferenceList)
+        return;
+
+    const QStringList previous = techPreferenceList;
+    techPreferenceList = preference;
+    if (!connmanSetUp)
+        return;
+
+    qCInfo(connAgent) << "Technology preference now" << techPreferenceList;
+    for (const QString &tech : techPreferenceList) {
+        if (!previous.contains(tech)) {
+            // services of a new technology have to be picked up
+            updateServices();
+            return;
+        }
+    }
+
+    // the same services, only their order changes
+    ServiceList reordered;
+    reordered.reserve(orderedServicesList.count());
+    for (const QString &tech : techPreferenceList) {
+        for (const Service &elem : orderedServicesList) {
+            if (elem.service->type() == tech)
+                reordered << elem;
+        }
+    }
+    orderedServicesList = reordered;
+}
+
+void QConnectionAgent::setup()
+{
+    TRACE_FUNCTION();
+    StartupTimings::Phase phase("setup");
+    qCDebug(connAgent) << Q_FUNC_INFO << netman->globalState();
+    connmanSetUp = true;
 
+    StartupTimings::instance()->begin("enumeration");
     updateServices();
     offlineModeChanged(netman->offlineMode());
+    StartupTimings::instance()->end("enumeration");
 
-    QSettings confFile;
-    confFile.beginGroup("Connectionagent");
-    scanTimeoutInterval = confFile.value("scanTimerInterval", "1").toUInt(); //in minutes
+    StartupTimings::instance()->begin("settings");
+    applySettings();
+    StartupTimings::instance()->end("settings");
 
     if (isStateOnline(netman->globalState())) {
         qCInfo(connAgent) << "Default route type:" << netman->defaultRoute()->type();
-        if (netman->defaultRoute()->type() == "ethernet")
-            isEthernet = true;
         if (netman->defaultRoute()->type() == "cellular" && scanTimeoutInterval != 0)
             scanTimer->start(scanTimeoutInterval * 60 * 1000);
 
     }
+    updateEthernetPowerSave();
 
-    tetherBtWhenPowered = confFile.value("tetheringBtEnabled", false).toBool();
+    tetherBtWhenPowered = config->value("tetheringBtEnabled", false).toBool();
 
     if (tetherBtWhenPowered) {
         tetheringBtTech = netman->getTechnology("bluetooth");
@@ -426,26 +928,62 @@ void QConnectionAgent::setup()
             connect(tetheringBtTech, &NetworkTechnology::tetheringChanged,
                     this, &QConnectionAgent::techTetheringChanged, Qt::UniqueConnection);
             if (tetheringBtTech->powered()) {
-                tetheringBtTech->setTethering(true);
+                EventJournal::request(EventJournal::TetheringOn, tetheringBtTech->type());
+                TRACE_CALL("setTethering", tetheringBtTech->setTethering(true));
             }
         }
     }
-    qCDebug(connAgent) << "Config file says" << confFile.value("connected", "online").toString();
+    qCDebug(connAgent) << "Config file says" << config->value("connected", "online").toString();
+    reconcileSnapshot();
+    StartupTimings::instance()->ready();
+}
+
+void QConnectionAgent::applySettings()
+{
+    TRACE_FUNCTION();
+    scanTimeoutInterval = config->value("scanTimerInterval", "1").toUInt(); //in minutes
+    wifiTethering->setTimeout(config->value("tetheringTimeout", 30).toInt() * 1000); //in seconds
+    tetheringTraffic->setInterface(config->value("tetheringInterface", "tether").toString());
+    tetheringTraffic->setIdleTimeout(config->value("tetheringIdleTimeout", 10).toInt() * 60 * 1000); //in minutes, 0 disables
+    handover->setMakeBeforeBreak(config->value("makeBeforeBreak", true).toBool());
+    handover->setDeadline(config->value("handoverDeadline", 15).toInt() * 1000); //in seconds
+    connectRacing = config->value("connectRacing", false).toBool();
+    connectRaceCandidates = qMax(1, config->value("connectRaceCandidates", 3).toInt());
+    connectRaceConcurrency = qMax(1, config->value("connectRaceConcurrency", 2).toInt());
+    connectRace->setStagger(config->value("connectRaceStagger", 5000).toInt()); //in milliseconds
+    migrationEngine->setEnabled(config->value("migrationEnabled", true).toBool());
+    migrationEngine->setMargin(config->value("migrationMargin", 15).toInt());
+    migrationEngine->setDwellTime(config->value("migrationDwellTime", 30).toInt() * 1000); //in seconds
+    qualityProber->setEndpoint(config->value("qualityProbeHost", "ipv4.jolla.com").toString(),
+                               config->value("qualityProbePort", 80).toUInt());
+    qualityProber->setBurst(config->value("qualityProbeBurst", 3).toInt());
+    portalCache->setValidity(config->value("portalLoginValidity", 60).toInt() * 60 * 1000); //in minutes, 0 disables
+    portalCache->setCheckUrl(QUrl(config->value("portalCheckUrl", "http://ipv4.jolla.com/online/status.html").toString()));
+    retryScheduler->setBackoff(config->value("retryBackoff", 30).toInt() * 1000, //in seconds
+                               config->value("retryBackoffMax", 30).toInt() * 60 * 1000); //in minutes
+    ethernetPowerSave->setEnabled(config->value("ethernetPowerSave", true).toBool());
+    applyAlwaysConnected();
+    credentialProvider->setEnabled(config->value("credentialProvider", false).toBool());
+    lagMonitor->setInterval(config->value("lagMonitorInterval", 1000).toInt()); //in milliseconds
+    lagMonitor->setThreshold(config->value("lagMonitorThreshold", 500).toInt()); //in milliseconds
+    if (config->value("lagMonitor", false).toBool())
+        lagMonitor->startMonitoring();
+    else
+        lagMonitor->stopMonitoring();
+    idleReclaimer->setIdleDelay(config->value("idleDelay", 5).toInt() * 60 * 1000); //in minutes
+    idleReclaimer->setEnabled(config->value("idleReclaim", true).toBool());
 }
 
 void QConnectionAgent::technologyPowerChanged(bool powered)
 {
+    TRACE_FUNCTION();
     NetworkTechnology *tech = static_cast<NetworkTechnology *>(sender());
     if (tech->type() == "wifi") {
+        // wifi tethering bring-up follows the power state in wifiTethering
         if (tetheringWifiTech)
             qCInfo(connAgent) << tetheringWifiTech->name() << powered;
         else
             qCDebug(connAgent) << "tetheringWifiTech is null";
-
-        if (netman && powered && tetherWifiWhenPowered) {
-            // wifi tech might not be ready, so delay this
-            QTimer::singleShot(1000, this, &QConnectionAgent::enableWifiTethering);
-        }
     } else if (tech->type() == "bluetooth") {
         if (netman && powered && tetherBtWhenPowered) { 
             // This doesn't need to be turned off when de-powered
@@ -456,11 +994,12 @@ void QConnectionAgent::technologyPowerChanged(bool powered)
 
 void QConnectionAgent::techChanged()
 {
+    TRACE_FUNCTION();
     if (netman->getTechnologies().isEmpty()) {
         knownTechnologies.clear();
     }
     if (netman->getTechnology("wifi") == nullptr) {
-        tetherWifiWhenPowered = false;
+        wifiTethering->stop();
         tetheringWifiTech = nullptr;
     }
     if (netman->getTechnology("bluetooth") == nullptr) {
@@ -489,64 +1028,67 @@ void QConnectionAgent::techChanged()
 
 void QConnectionAgent::techTetheringChanged(bool on)
 {
+    TRACE_FUNCTION();
     qCDebug(connAgent) << on;
     NetworkTechnology *technology = static_cast<NetworkTechnology *>(sender());
     if (technology && technology->type() == "bluetooth" && on) {
         Q_EMIT bluetoothTetheringFinished(true);
-    } else if (technology && technology->type() == "wifi" && on && tetherWifiWhenPowered) {
-        QVector <NetworkService *> services = netman->getServices("cellular");
-        if (services.isEmpty())
-            return;
-        NetworkService* cellService = services.at(0);
-
-        if (cellService) {
-            if (cellService->serviceState() == NetworkService::IdleState
-                    || cellService->serviceState() == NetworkService::FailureState) {
-                qCInfo(connAgent) << "Requesting cell connect";
-                cellService->requestConnect();
-            } else if (cellService->connected()) {
-                tetherWifiWhenPowered = false;
-                Q_EMIT wifiTetheringFinished(true);
-            }
-        } else {
-            stopTethering("wifi");
-        }
     }
 }
 
 void QConnectionAgent::offlineModeChanged(bool offline)
 {
+    TRACE_FUNCTION();
+    EventJournal::record(EventJournal::OfflineMode, 0, offline);
     flightModeSuppression = offline;
     if (offline) {
-        QTimer::singleShot(5 * 1000 * 60, this, &QConnectionAgent::flightModeDialogSuppressionTimeout); //5 minutes
+        flightModeTimer->start();
     }
 }
 
 void QConnectionAgent::flightModeDialogSuppressionTimeout()
 {
+    TRACE_FUNCTION();
     flightModeSuppression = false;
 }
 
 void QConnectionAgent::serviceAutoconnectChanged(bool on)
 {
+    TRACE_FUNCTION();
     NetworkService *service = qobject_cast<NetworkService *>(sender());
     if (!service)
         return;
     qCDebug(connAgent) << service->path() << "AutoConnect is" << on;
 
     if (!on) {
-        if (service->serviceState() != NetworkService::IdleState)
-            service->requestDisconnect();
+        if (service->serviceState() != NetworkService::IdleState) {
+            EventJournal::request(EventJournal::Disconnect, service->path());
+            TRACE_CALL("requestDisconnect", service->requestDisconnect());
+        }
     }
 }
 
 void QConnectionAgent::scanTimeout()
 {
+    TRACE_FUNCTION();
     if (!tetheringWifiTech || tetheringWifiTech->tethering())
         return;
 
+    if (ethernetPowerSave->isActive()) {
+        // restarted once the cable goes away
+        ethernetPowerSave->scanSkipped();
+        return;
+    }
+
     if (tetheringWifiTech->powered() && !tetheringWifiTech->connected() && netman->defaultRoute()->type() != "wifi" ) {
-        tetheringWifiTech->scan();
+        if (scanPredictor->shouldSuppressScan()) {
+            qCDebug(connAgent) << "no known networks in cell" << scanPredictor->cell() << ", skipping scan";
+            if (scanTimeoutInterval != 0)
+                scanTimer->start(scanTimeoutInterval * 60 * 1000);
+            return;
+        }
+        EventJournal::request(EventJournal::Scan, tetheringWifiTech->type());
+        TRACE_CALL("scan", tetheringWifiTech->scan());
         qCDebug(connAgent) << "start scanner" << scanTimeoutInterval;
         if (scanTimeoutInterval != 0) {
             scanTimer->start(scanTimeoutInterval * 60 * 1000);
@@ -562,6 +1104,20 @@ void QConnectionAgent::removeAllTypes(const QString &type)
     }
 }
 
+QVector<NetworkService *> QConnectionAgent::tetheringUplinkCandidates() const
+{
+    // every cellular service, plus whatever else is already up and does not
+    // share the radio with the access point
+    QVector<NetworkService *> candidates = netman->getServices("cellular");
+    for (NetworkService *service : netman->getServices()) {
+        if (service->type() != "cellular" && service->type() != "wifi"
+                && isStateOnline(service->serviceState())) {
+            candidates << service;
+        }
+    }
+    return candidates;
+}
+
 bool QConnectionAgent::shouldSuppressError(const QString &error, bool cellular) const
 {
     if (error.isEmpty())
@@ -582,6 +1138,7 @@ bool QConnectionAgent::shouldSuppressError(const QString &error, bool cellular)
 
 void QConnectionAgent::openConnectionDialog(const QString &type)
 {
+    TRACE_FUNCTION();
     // open Connection Selector
     QDBusInterface *connSelectorInterface = new QDBusInterface(QStringLiteral("com.jolla.lipstick.ConnectionSelector"),
                                                                QStringLiteral("/"),
@@ -604,10 +1161,13 @@ void QConnectionAgent::openConnectionDialog(const QString &type)
 
 void QConnectionAgent::startTethering(const QString &type)
 {
+    TRACE_FUNCTION();
+    idleReclaimer->activity();
     if (type != "wifi" && type !="bluetooth") { // support wifi and bt
         return;
     }
     qCDebug(connAgent) << "startTethering" << type;
+    EventJournal::record(EventJournal::Tethering, type, EventJournal::TetheringStarting);
     NetworkTechnology *tetherTech = netman->getTechnology(type);
     if (!tetherTech) {
         if (type == "wifi") {
@@ -619,37 +1179,27 @@ void QConnectionAgent::startTethering(const QString &type)
     }
 
     bool techPowered = tetherTech->powered();
-    QSettings confFile;
-    confFile.beginGroup("Connectionagent");
-
-    if (type == "wifi") { // Only force cellular on for wifi. Bt can use either when available.
-        QVector <NetworkService *> services = netman->getServices("cellular");
-        if (services.isEmpty()) {
+    if (type == "wifi") { // Only force an uplink on for wifi. Bt can use either when available.
+        uplinkSelector->setCandidates(tetheringUplinkCandidates());
+        // ranked on what earlier probes measured, the candidates are probed
+        // again once tethering is up
+        NetworkService *uplink = uplinkSelector->best();
+        if (!uplink || netman->offlineMode()) {
             Q_EMIT wifiTetheringFinished(false);
             return;
         }
-        NetworkService *cellService = services.at(0);
-        if (!cellService || netman->offlineMode()) {
-            Q_EMIT wifiTetheringFinished(false);
-            return;
-        }
-        bool cellConnected = cellService->connected();
-        bool cellAutoconnect = cellService->autoConnect();
 
-        // save cellular connection state
-        confFile.setValue("tetheringCellularConnected", cellConnected);
-        confFile.setValue("tetheringCellularAutoconnect", cellAutoconnect);
-    
         // save wifi powered state
-        confFile.setValue("tetheringTechPowered", techPowered);
+        config->setValue("tetheringTechPowered", techPowered);
+        // taken before start() connects it, connman may turn AutoConnect on
+        const bool uplinkAutoconnect = uplink->autoConnect();
 
         tetheringWifiTech = tetherTech;
-        tetherWifiWhenPowered = true;
-        // Only wifi tethering powers up when enabled. BT will wait until 
+        // Only wifi tethering powers up when enabled. BT will wait until
         // it's next turned on.
-        if (!techPowered) {
-            tetherTech->setPowered(true);
-        }
+        wifiTethering->start(tetherTech, uplink);
+        saveTetheringUplink(uplink, wifiTethering->uplinkBroughtUp(), uplinkAutoconnect);
+        return;
 
     } else if (type == "bluetooth") {
         // Bluetooth tethering is passive: it does not affect the network connection
@@ -657,69 +1207,469 @@ void QConnectionAgent::startTethering(const QString &type)
         // connected. It is persistent across flight mode and reboots.
         tetheringBtTech = tetherTech;
         tetherBtWhenPowered = true;
-        if (!confFile.value("tetheringBtEnabled", false).toBool()) {
-            confFile.setValue("tetheringBtEnabled", true);
+        if (!config->value("tetheringBtEnabled", false).toBool()) {
+            config->setValue("tetheringBtEnabled", true);
         }
     }
 
     if (techPowered) {
-        tetherTech->setTethering(true);
+        EventJournal::request(EventJournal::TetheringOn, tetherTech->type());
+        TRACE_CALL("setTethering", tetherTech->setTethering(true));
     }
 }
 
 void QConnectionAgent::stopTethering(const QString &type, bool keepPowered)
 {
-    QSettings confFile;
-    confFile.beginGroup("Connectionagent");
+    TRACE_FUNCTION();
+    idleReclaimer->activity();
+    EventJournal::record(EventJournal::Tethering, type, EventJournal::TetheringStopped);
+
+    if (type == "wifi") {
+        wifiTethering->stop();
+        tetheringTraffic->stop();
+        uplinkSelector->stopMonitoring();
+    }
 
     NetworkTechnology *tetherTech = netman->getTechnology(type);
     if (tetherTech && tetherTech->tethering()) {
-        tetherTech->setTethering(false);
-    }
-
-    if (type == "wifi") { // restore cellular data state
-        tetherWifiWhenPowered = false;
-        bool b = confFile.value("tetheringCellularConnected").toBool();
-        bool ab = confFile.value("tetheringCellularAutoconnect").toBool();
-    
-        for (Service elem : orderedServicesList) {
-            if (elem.path.contains("cellular")) {
-                if (isStateOnline(elem.service->serviceState())) {
-                    qCDebug(connAgent) << "disconnect mobile data";
-                    if (!b)
-                        elem.service->requestDisconnect();
-                    if (!ab)
-                        elem.service->setAutoConnect(false);
-                }
+        EventJournal::request(EventJournal::TetheringOff, tetherTech->type());
+        TRACE_CALL("setTethering", tetherTech->setTethering(false));
+    }
+
+    if (type == "wifi") { // restore the uplink state, only what tethering brought up goes down
+        const int index = orderedServicesList.indexOf(config->value("tetheringUplink").toString());
+        NetworkService *uplink = index >= 0 ? orderedServicesList.at(index).service : nullptr;
+        if (uplink && isStateOnline(uplink->serviceState())) {
+            if (!config->value("tetheringCellularConnected", true).toBool()) {
+                qCDebug(connAgent) << "disconnect tethering uplink" << uplink->path();
+                EventJournal::request(EventJournal::Disconnect, uplink->path());
+                TRACE_CALL("requestDisconnect", uplink->requestDisconnect());
             }
+            if (!config->value("tetheringCellularAutoconnect", true).toBool())
+                TRACE_CALL("setAutoConnect", uplink->setAutoConnect(false));
         }
-        b = confFile.value("tetheringTechPowered").toBool();
+        config->remove("tetheringUplink");
+        bool b = config->value("tetheringTechPowered").toBool();
         if (!b && tetherTech && !keepPowered) {
-            tetherTech->setPowered(false);
+            EventJournal::request(EventJournal::PowerOff, tetherTech->type());
+            TRACE_CALL("setPowered", tetherTech->setPowered(false));
         }
         Q_EMIT wifiTetheringFinished(false);
     } else if (type == "bluetooth") {
         tetherBtWhenPowered = false;
-        confFile.setValue("tetheringBtEnabled", false);
+        config->setValue("tetheringBtEnabled", false);
         if (tetherTech && !keepPowered) {
-            tetherTech->setPowered(false);
+            EventJournal::request(EventJournal::PowerOff, tetherTech->type());
+            TRACE_CALL("setPowered", tetherTech->setPowered(false));
         }
         Q_EMIT bluetoothTetheringFinished(false);
     }
 }
 
-void QConnectionAgent::enableWifiTethering()
+void QConnectionAgent::wifiTetheringBringUpFinished(bool success)
 {
-    if (tetheringWifiTech) {
-        qCInfo(connAgent) << "Setting Wifi tethering" << (tetherWifiWhenPowered ? "on" : "off");
-        tetheringWifiTech->setTethering(tetherWifiWhenPowered);
+    TRACE_FUNCTION();
+    EventJournal::record(EventJournal::Tethering, QStringLiteral("wifi"),
+                         success ? EventJournal::TetheringUp : EventJournal::TetheringFailed);
+    // a failure after a successful bring-up is tethering lost while active
+    const QVariantMap bringUp = wifiTethering->lastBringUp();
+    if (success || !bringUp.value(QStringLiteral("success")).toBool()) {
+        metrics->record(QStringLiteral("tethering_bringup"),
+                        bringUp.value(QStringLiteral("total")).toLongLong() * 1000);
+        metrics->increment(success ? QStringLiteral("tethering_bringup.success")
+                                   : QStringLiteral("tethering_bringup.failure"));
+    }
+    if (success) {
+        tetheringTraffic->start();
+        uplinkSelector->monitor(wifiTethering->uplink(), wifiTethering->uplinkBroughtUp());
+        Q_EMIT wifiTetheringFinished(true);
+    } else {
+        // also when tethering was lost while active, the sampler must not outlive it
+        tetheringTraffic->stop();
+        // restores the saved cellular and wifi state and reports the failure
+        stopTethering("wifi");
     }
 }
 
+void QConnectionAgent::tetheringUplinkChanged(NetworkService *uplink)
+{
+    TRACE_FUNCTION();
+    // a switch to a service that was not connected brought it up for tethering
+    wifiTethering->setUplink(uplink, uplinkSelector->isBroughtUp());
+    saveTetheringUplink(uplink, uplinkSelector->isBroughtUp(), uplinkSelector->previousAutoConnect());
+}
+
+// kept in the settings so the uplink is restored also after a restart
+void QConnectionAgent::saveTetheringUplink(NetworkService *uplink, bool broughtUp, bool autoConnect)
+{
+    config->setValue("tetheringUplink", uplink->path());
+    config->setValue("tetheringCellularConnected", !broughtUp);
+    config->setValue("tetheringCellularAutoconnect", autoConnect);
+}
+
 void QConnectionAgent::enableBtTethering()
 {
+    TRACE_FUNCTION();
     if (tetheringBtTech) {
         qCInfo(connAgent) << "Setting Bluetooth tethering" << (tetherBtWhenPowered ? "on" : "off");
-        tetheringBtTech->setTethering(tetherBtWhenPowered && tetheringBtTech->powered());
+        const bool on = tetherBtWhenPowered && tetheringBtTech->powered();
+        EventJournal::request(on ? EventJournal::TetheringOn : EventJournal::TetheringOff, tetheringBtTech->type());
+        TRACE_CALL("setTethering", tetheringBtTech->setTethering(on));
+    }
+}
+
+void QConnectionAgent::wifiTetheringIdle(qint64 idleMsecs, quint64 bytesTransferred)
+{
+    TRACE_FUNCTION();
+    qCInfo(connAgent) << "Wifi tethering idle for" << idleMsecs / 1000 << "s,"
+                      << bytesTransferred << "bytes transferred, stopping";
+    EventJournal::record(EventJournal::Tethering, QStringLiteral("wifi"), EventJournal::TetheringIdleStopped);
+    Q_EMIT wifiTetheringIdleStopped(idleMsecs / 1000, bytesTransferred);
+    stopTethering("wifi");
+}
+
+void QConnectionAgent::evaluateMigration()
+{
+    TRACE_FUNCTION();
+    // the wifi radio belongs to the access point while tethering
+    if (wifiTethering->isRunning() || netman->offlineMode())
+        return;
+
+    QVector<NetworkService *> services;
+    services.reserve(orderedServicesList.count());
+    for (const Service &elem : orderedServicesList) {
+        if (!retryScheduler->isQuarantined(elem.path))
+            services << elem.service;
+    }
+
+    migrationEngine->evaluate(services, netman->defaultRoute());
+}
+
+void QConnectionAgent::migrateService(NetworkService *from, NetworkService *to)
+{
+    TRACE_FUNCTION();
+    if (isStateOnline(to->serviceState())) {
+        // already up, connman moves the default route once the old one is gone
+        EventJournal::request(EventJournal::Disconnect, from->path());
+        TRACE_CALL("requestDisconnect", from->requestDisconnect());
+    } else {
+        qCDebug(connAgent) << "<<<<<<<<<<< requestConnect() >>>>>>>>>>>>";
+        EventJournal::request(EventJournal::Connect, to->path());
+        TRACE_CALL("requestConnect", to->requestConnect());
+    }
+}
+
+void QConnectionAgent::connectRaceFinished(NetworkService *winner, qint64 elapsed)
+{
+    TRACE_FUNCTION();
+    // per-attempt times to online end up in serviceHistory
+    if (winner)
+        qCInfo(connAgent) << "Connect race won by" << winner->path() << "in" << elapsed << "ms";
+    else
+        qCInfo(connAgent) << "Connect race ended without a winner after" << elapsed << "ms";
+}
+
+void QConnectionAgent::predictedScan()
+{
+    TRACE_FUNCTION();
+    if (!tetheringWifiTech || tetheringWifiTech->tethering() || !tetheringWifiTech->powered()
+            || tetheringWifiTech->connected() || netman->defaultRoute()->type() == "wifi")
+        return;
+    if (ethernetPowerSave->isActive()) {
+        ethernetPowerSave->scanSkipped();
+        return;
+    }
+
+    qCDebug(connAgent) << "entered cell" << scanPredictor->cell() << ", scanning";
+    EventJournal::request(EventJournal::Scan, tetheringWifiTech->type());
+    TRACE_CALL("scan", tetheringWifiTech->scan());
+    scanPredictor->scanIssued();
+}
+
+void QConnectionAgent::serviceQualityMeasured(const QString &servicePath, qint64 rtt, qreal loss)
+{
+    TRACE_FUNCTION();
+    Q_UNUSED(rtt);
+    Q_UNUSED(loss);
+    migrationEngine->setQuality(servicePath, QualityProber::quality(qualityProber->result(servicePath)));
+}
+
+void QConnectionAgent::handoverVerified(const QString &servicePath, bool online)
+{
+    TRACE_FUNCTION();
+    // a wifi that serves the online check is usable even if connman has not
+    // yet declared it online
+    int index = orderedServicesList.indexOf(servicePath);
+    if (online && handover->isActive() && index >= 0)
+        handover->confirm(orderedServicesList.at(index).service);
+}
+
+void QConnectionAgent::retryService(const QString &servicePath)
+{
+    TRACE_FUNCTION();
+    int index = orderedServicesList.indexOf(servicePath);
+    if (index < 0 || netman->offlineMode() || wifiTethering->isRunning())
+        return;
+
+    NetworkService *service = orderedServicesList.at(index).service;
+    if (!service->autoConnect() || service->serviceState() != NetworkService::FailureState)
+        return;
+
+    for (const Service &elem : orderedServicesList) {
+        if (elem.service->type() == service->type() && isStateOnline(elem.service->serviceState()))
+            return;
+    }
+
+    qCDebug(connAgent) << "<<<<<<<<<<< requestConnect() >>>>>>>>>>>>" << servicePath << "after quarantine";
+    EventJournal::request(EventJournal::Connect, service->path());
+    TRACE_CALL("requestConnect", service->requestConnect());
+}
+
+void QConnectionAgent::updateEthernetPowerSave()
+{
+    TRACE_FUNCTION();
+    isEthernet = isStateOnline(netman->globalState()) && netman->defaultRoute()
+            && netman->defaultRoute()->type() == "ethernet";
+
+    QVector<NetworkService *> cellular;
+    for (const Service &elem : orderedServicesList) {
+        if (elem.service->type() == "cellular")
+            cellular << elem.service;
+    }
+    // tethering manages its own uplink
+    ethernetPowerSave->update(isEthernet && !wifiTethering->isRunning(), cellular);
+}
+
+void QConnectionAgent::ethernetLost()
+{
+    TRACE_FUNCTION();
+    if (!tetheringWifiTech || tetheringWifiTech->tethering() || !tetheringWifiTech->powered())
+        return;
+
+    EventJournal::request(EventJournal::Scan, tetheringWifiTech->type());
+    TRACE_CALL("scan", tetheringWifiTech->scan());
+    if (scanTimeoutInterval != 0)
+        scanTimer->start(scanTimeoutInterval * 60 * 1000);
+}
+
+void QConnectionAgent::prepareForSleep()
+{
+    TRACE_FUNCTION();
+    EventJournal::record(EventJournal::Sleep, 0, 1);
+    // timers would fire all at once on resume, keep what was left of them
+    scanTimeRemaining = scanTimer->isActive() ? scanTimer->remainingTime() : -1;
+    flightModeTimeRemaining = flightModeTimer->isActive() ? flightModeTimer->remainingTime() : -1;
+    scanTimer->stop();
+    flightModeTimer->stop();
+
+    sleepDefaultService.clear();
+    if (isStateOnline(netman->globalState()) && netman->defaultRoute())
+        sleepDefaultService = netman->defaultRoute()->path();
+    qCInfo(connAgent) << "Going to sleep, default service" << sleepDefaultService;
+}
+
+void QConnectionAgent::resumeFromSleep()
+{
+    TRACE_FUNCTION();
+    EventJournal::record(EventJournal::Sleep, 0, 0);
+    if (scanTimeRemaining >= 0)
+        scanTimer->start(scanTimeRemaining);
+    if (flightModeTimeRemaining >= 0)
+        flightModeTimer->start(flightModeTimeRemaining);
+    scanTimeRemaining = -1;
+    flightModeTimeRemaining = -1;
+
+    if (isStateOnline(netman->globalState())) {
+        sleepWatcher->online();
+        return;
+    }
+
+    int index = orderedServicesList.indexOf(sleepDefaultService);
+    if (index < 0 || netman->offlineMode())
+        return;
+
+    // connman would get there too, but only at its own autoconnect pace
+    NetworkService *service = orderedServicesList.at(index).service;
+    if (service->serviceState() == NetworkService::IdleState
+            || service->serviceState() == NetworkService::FailureState
+            || service->serviceState() == NetworkService::DisconnectState) {
+        qCDebug(connAgent) << "<<<<<<<<<<< requestConnect() >>>>>>>>>>>>" << sleepDefaultService << "after resume";
+        EventJournal::request(EventJournal::Connect, service->path());
+        TRACE_CALL("requestConnect", service->requestConnect());
+    }
+}
+
+void QConnectionAgent::recordStateMetrics(NetworkService *service, NetworkService::ServiceState state)
+{
+    EventJournal::record(EventJournal::ServiceState, service->path(), EventJournal::intern(stateName(state)));
+    metrics->increment(QStringLiteral("state_transitions.") + stateName(state));
+
+    const QString path = service->path();
+    if (state == NetworkService::AssociationState || state == NetworkService::ConfigurationState) {
+        if (!connectClocks.contains(path))
+            connectClocks[path].start();
+    } else if (state == NetworkService::OnlineState) {
+        QHash<QString, QElapsedTimer>::iterator it = connectClocks.find(path);
+        if (it != connectClocks.end()) {
+            metrics->record(QStringLiteral("time_to_online.") + service->type(), it->nsecsElapsed() / 1000);
+            connectClocks.erase(it);
+        }
+    } else if (state != NetworkService::ReadyState) {
+        connectClocks.remove(path);
+    }
+}
+
+void QConnectionAgent::unixSignalReceived(int signum)
+{
+    TRACE_FUNCTION();
+    if (signum != SIGUSR2)
+        return;
+
+    // toggles debug output of the agent without a restart
+    if (LogSink::instance()->filterRules().isEmpty())
+        setLoggingRules(QStringLiteral("org.sailfishos.connectionagent.debug=true"));
+    else
+        setLoggingRules(QString());
+}
+
+void QConnectionAgent::shutdown()
+{
+    TRACE_FUNCTION();
+    lagMonitor->stopMonitoring();
+    config->flush();
+    if (!connmanSetUp)
+        return;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    WarmSnapshot snapshot;
+    for (const Service &elem : orderedServicesList) {
+        WarmSnapshot::Service service = { elem.path, elem.service->autoConnect() };
+        snapshot.services << service;
+    }
+    snapshot.wifiTethering = wifiTethering->isRunning();
+    if (snapshot.wifiTethering && wifiTethering->uplink())
+        snapshot.tetheringUplink = wifiTethering->uplink()->path();
+    snapshot.flightModeSuppression = flightModeSuppression;
+    if (flightModeTimer->isActive())
+        snapshot.flightModeDeadline = now + flightModeTimer->remainingTime();
+    if (scanTimer->isActive())
+        snapshot.scanDeadline = now + scanTimer->remainingTime();
+    snapshot.retryState = retryScheduler->saveState();
+
+    if (snapshot.save(WarmSnapshot::defaultFileName()))
+        qCInfo(connAgent) << "Saved snapshot of" << snapshot.services.count() << "services";
+}
+
+void QConnectionAgent::restoreSnapshot()
+{
+    if (!warmSnapshot.take(WarmSnapshot::defaultFileName(), MaxSnapshotAge))
+        return;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qCInfo(connAgent) << "Warm restart, snapshot taken" << now - warmSnapshot.savedAt << "ms ago";
+    retryScheduler->restoreState(warmSnapshot.retryState);
+    flightModeSuppression = warmSnapshot.flightModeSuppression && warmSnapshot.flightModeDeadline > now;
+    if (flightModeSuppression)
+        flightModeTimer->start(int(warmSnapshot.flightModeDeadline - now));
+}
+
+void QConnectionAgent::reconcileSnapshot()
+{
+    if (!warmSnapshot.isValid())
+        return;
+
+    // connman's offline mode and default route were applied by now, only
+    // carry over the time left on the timers they started
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (flightModeSuppression && warmSnapshot.flightModeDeadline > now)
+        flightModeTimer->start(int(qMin<qint64>(warmSnapshot.flightModeDeadline - now, flightModeTimer->interval())));
+    if (scanTimer->isActive() && warmSnapshot.scanDeadline > now)
+        scanTimer->start(int(qMin<qint64>(warmSnapshot.scanDeadline - now, scanTimer->interval())));
+
+    if (warmSnapshot.wifiTethering && !wifiTethering->isRunning() && !netman->offlineMode()) {
+        NetworkTechnology *tech = netman->getTechnology("wifi");
+        int index = orderedServicesList.indexOf(warmSnapshot.tetheringUplink);
+        NetworkService *uplink = index >= 0 ? orderedServicesList.at(index).service : nullptr;
+        if (!uplink) {
+            uplinkSelector->setCandidates(tetheringUplinkCandidates());
+            uplink = uplinkSelector->best();
+        }
+        if (tech && uplink) {
+            qCInfo(connAgent) << "Resuming wifi tethering over" << uplink->path();
+            // the cellular and power state to go back to were saved when tethering was started
+            tetheringWifiTech = tech;
+            wifiTethering->start(tech, uplink);
+        }
+    }
+
+    warmSnapshot = WarmSnapshot();
+}
+
+void QConnectionAgent::enterIdleMode()
+{
+    TRACE_FUNCTION();
+    // tethering is never idle, however quiet its clients are
+    if (wifiTethering->isStarting() || wifiTethering->isRunning()
+            || (tetheringBtTech && tetheringBtTech->tethering())) {
+        idleReclaimer->activity();
+        return;
+    }
+    for (QHash<QString, QElapsedTimer>::const_iterator it = connectClocks.constBegin(); it != connectClocks.constEnd(); ++it) {
+        if (orderedServicesList.contains(it.key())) {
+            // a connect is still in progress
+            idleReclaimer->activity();
+            return;
+        }
+    }
+
+    qCInfo(connAgent) << "Entering idle mode";
+    reclaimMemory("idle");
+    // nothing happens that would need timing
+    lagMonitor->stopMonitoring();
+    idleReclaimer->enterIdle();
+}
+
+void QConnectionAgent::leaveIdleMode()
+{
+    TRACE_FUNCTION();
+    if (config->value("lagMonitor", false).toBool())
+        lagMonitor->startMonitoring();
+}
+
+void QConnectionAgent::memoryPressure()
+{
+    TRACE_FUNCTION();
+    reclaimMemory("pressure");
+}
+
+void QConnectionAgent::reclaimMemory(const char *reason)
+{
+    const qint64 rssBefore = IdleReclaimer::residentSize();
+
+    // state kept per service is only needed for the services connman still has
+    QStringList paths;
+    paths.reserve(orderedServicesList.count());
+    for (const Service &elem : orderedServicesList)
+        paths << elem.path;
+
+    for (QHash<QString, QElapsedTimer>::iterator it = connectClocks.begin(); it != connectClocks.end();) {
+        if (paths.contains(it.key()))
+            ++it;
+        else
+            it = connectClocks.erase(it);
     }
+    connectClocks.squeeze();
+    qualityProber->retain(paths);
+    migrationEngine->retain(paths);
+    portalCache->retain(paths);
+    if (!wifiTethering->isStarting() && !wifiTethering->isRunning())
+        uplinkSelector->release();
+    orderedServicesList.squeeze();
+    IdleReclaimer::releaseHeap();
+
+    const qint64 rssAfter = IdleReclaimer::residentSize();
+    idleReclaimer->reclaimed(QString::fromLatin1(reason), rssBefore, rssAfter);
+    metrics->increment(QStringLiteral("memory_reclaims.") + QString::fromLatin1(reason));
+    qCInfo(connAgent) << "Memory reclaimed on" << reason << ", RSS" << rssBefore << "kB before,"
+                      << rssAfter << "kB after";
 }
@@ -17,6 +17,8 @@
 #define QCONNECTIONAGENT_H
 
 #include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QStringList>
 #include <QVariant>
 #include <QVector>
@@ -24,10 +26,32 @@
 
 #include "networkmanager.h"
 #include "networkservice.h"
+#include "warmsnapshot.h"
 
 class UserAgent;
 class NetworkService;
 class NetworkTechnology;
+class TetheringStateMachine;
+class TrafficSampler;
+class UplinkSelector;
+class MigrationEngine;
+class ServiceHistory;
+class ConnectRace;
+class CellLocator;
+class ScanPredictor;
+class HandoverController;
+class QualityProber;
+class PortalCache;
+class CredentialProvider;
+class RetryScheduler;
+class EthernetPowerSave;
+class SleepWatcher;
+class Metrics;
+class LagMonitor;
+class AgentConfig;
+class ConnmanConfig;
+class IdleReclaimer;
+class QDBusPendingCallWatcher;
 class QTimer;
 
 class QConnectionAgent : public QObject
@@ -51,18 +75,39 @@ Q_SIGNALS:
 
     void requestBrowser(const QString &url, const QString &serviceName);
     void wifiTetheringFinished(bool);
+    void wifiTetheringIdleStopped(uint idleTime, qulonglong bytesTransferred);
     void bluetoothTetheringFinished(bool);
 
 public Q_SLOTS:
     void onErrorReported(const QString &servicePath, const QString &error);
 
     void onConnectionRequest();
+    // Saves the warm restart snapshot, called when the application quits
+    void shutdown();
     void onBrowserRequested(const QString &url, const QString &serviceName);
 
     void sendConnectReply(const QString &in0, int in1);
     void sendUserReply(const QVariantMap &input);
 
     void connectToType(const QString &type);
+    QVariantMap connectionHistory() const;
+    QVariantMap scanPredictionStatistics() const;
+    QVariantMap handoverStatistics() const;
+    QVariantMap serviceQuality() const;
+    QVariantMap portalStatistics() const;
+    QVariantMap credentialStatistics() const;
+    QVariantMap serviceQuarantine() const;
+    void releaseQuarantine(const QString &servicePath);
+    QVariantMap ethernetPowerSaveStatistics() const;
+    QVariantMap resumeStatistics() const;
+    QVariantMap GetMetrics() const;
+    QVariantMap eventLoopLag() const;
+    QVariantMap startupTimings() const;
+    QByteArray DumpJournal() const;
+    QString DumpTrace() const;
+    void setLoggingRules(const QString &rules);
+    QVariantMap loggingStatus() const;
+    QVariantMap idleStatistics() const;
 
     void startTethering(const QString &type);
     void stopTethering(const QString &type, bool keepPowered = false);
@@ -105,8 +150,18 @@ private:
     };
 
     void setup();
+    void setupUserAgent();
+    void readConnmanConf();
+    void applyAlwaysConnected();
+    void setTechnologyPreference(const QStringList &preference);
+    void restoreSnapshot();
+    void reconcileSnapshot();
     void updateServices();
     void removeAllTypes(const QString &type);
+    QVector<NetworkService *> tetheringUplinkCandidates() const;
+    void saveTetheringUplink(NetworkService *uplink, bool broughtUp, bool autoConnect);
+    void reclaimMemory(const char *reason);
+    void recordStateMetrics(NetworkService *service, NetworkService::ServiceState state);
 
     bool shouldSuppressError(const QString &error, bool cellular) const;
 
@@ -118,10 +173,55 @@ private:
 
     NetworkTechnology *tetheringWifiTech;
     NetworkTechnology *tetheringBtTech;
-    // Turn on Wifi tethering when the tech is next powered up. Wifi will be turned on
-    // when this is enabled, so it won't be long. This gets reset once tethering is on
-    // so will not be restored after flight mode or power off
-    bool tetherWifiWhenPowered;
+    // Wifi tethering bring-up: powers Wifi and connects cellular in parallel, then
+    // turns tethering on. Not restored after flight mode or power off.
+    TetheringStateMachine *wifiTethering;
+    // Stops Wifi tethering when no client traffic was seen for tetheringIdleTimeout
+    TrafficSampler *tetheringTraffic;
+    // Measures rtt and loss of online services on their own interface
+    QualityProber *qualityProber;
+    // Ranks and watches the uplink used for Wifi tethering, probing through qualityProber
+    UplinkSelector *uplinkSelector;
+    // Moves the default route to a clearly better known service
+    MigrationEngine *migrationEngine;
+    // Persistent per-service connect statistics
+    ServiceHistory *serviceHistory;
+    // Races connects to the best few candidates in connectToType()
+    ConnectRace *connectRace;
+    bool connectRacing;
+    int connectRaceCandidates;
+    int connectRaceConcurrency;
+    // Scans for wifi when entering a cell where a favourite was joined before
+    CellLocator *cellLocator;
+    ScanPredictor *scanPredictor;
+    // Cellular to wifi handover, keeps cellular until wifi is proven
+    HandoverController *handover;
+    // Skips the portal browser while an earlier login on the network is still valid
+    PortalCache *portalCache;
+    // Answers input requests from provisioned credentials when enabled
+    CredentialProvider *credentialProvider;
+    QElapsedTimer userInputClock;
+    // Backs off autoconnect services that keep failing
+    RetryScheduler *retryScheduler;
+    // Suspends wifi scans and parks cellular while ethernet is the default route
+    EthernetPowerSave *ethernetPowerSave;
+    // Pauses timers over suspend and reconnects the default service on resume
+    SleepWatcher *sleepWatcher;
+    QString sleepDefaultService;
+    int scanTimeRemaining;
+    int flightModeTimeRemaining;
+    // Counters and latency histograms, dumped as text on SIGUSR1
+    Metrics *metrics;
+    // Watchdog thread timing the main loop, warns about blocking handlers
+    LagMonitor *lagMonitor;
+    // The Connectionagent settings group, held in memory and written behind
+    AgentConfig *config;
+    // connman's main.conf, watched for changes
+    ConnmanConfig *connmanConfig;
+    QStringList alwaysConnectedTechnologies;
+    // Drops per-service state and caches when nothing happens or memory is short
+    IdleReclaimer *idleReclaimer;
+    QHash<QString, QElapsedTimer> connectClocks;
     // Turn on Bluetooth tethering whenever the BT adaptor is powered on. This will not
     // get reset, and is stored persistently in config, so when the option is enabled
     // tethering will always be started when BT is powered on.
@@ -130,8 +230,13 @@ private:
     uint scanTimeoutInterval;
 
     QTimer *scanTimer;
+    QTimer *flightModeTimer;
     QStringList knownTechnologies;
     bool valid;
+    bool connmanSetUp;
+    bool connmanLost;
+    // State from before a restart, until connman has been enumerated
+    WarmSnapshot warmSnapshot;
 
 private slots:
     void serviceErrorChanged(const QString &error);
@@ -152,7 +257,30 @@ private slots:
     void techTetheringChanged(bool on);
 
     void openConnectionDialog(const QString &type);
-    void enableWifiTethering();
+    void wifiTetheringBringUpFinished(bool success);
+    void wifiTetheringIdle(qint64 idleMsecs, quint64 bytesTransferred);
+    void tetheringUplinkChanged(NetworkService *uplink);
+    void evaluateMigration();
+    void migrateService(NetworkService *from, NetworkService *to);
+    void connectRaceFinished(NetworkService *winner, qint64 elapsed);
+    void predictedScan();
+    void serviceQualityMeasured(const QString &servicePath, qint64 rtt, qreal loss);
+    void handoverVerified(const QString &servicePath, bool online);
+    void openPortalBrowser(const QString &servicePath, const QString &url);
+    void onUserInputRequested(const QString &servicePath, const QVariantMap &fields);
+    void retryService(const QString &servicePath);
+    void updateEthernetPowerSave();
+    void ethernetLost();
+    void prepareForSleep();
+    void resumeFromSleep();
+    void unixSignalReceived(int signum);
+    void discoverConnman();
+    void applySettings();
+    void applyConnmanConfig();
+    void connmanDiscovered(QDBusPendingCallWatcher *watcher);
+    void enterIdleMode();
+    void leaveIdleMode();
+    void memoryPressure();
     void enableBtTethering();
 };
 
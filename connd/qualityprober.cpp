@@ -0,0 +1,365 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "qualityprober.h"
+#include "tracing.h"
+
+#include <connman-qt5/networkservice.h>
+
+#include <QDateTime>
+#include <QHostAddress>
+#include <QHostInfo>
+#include <QLoggingCategory>
+#include <QNetworkAddressEntry>
+#include <QNetworkInterface>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+static const int ConnectTimeout = 3 * 1000;
+static const int MinProbeInterval = 30 * 1000;
+static const int MaxProbeInterval = 15 * 60 * 1000;
+
+// whether SO_BINDTODEVICE is permitted is only known after the first try
+enum DeviceBinding { DeviceBindingUnknown, DeviceBindingAllowed, DeviceBindingDenied };
+static DeviceBinding deviceBinding = DeviceBindingUnknown;
+static bool bindingUnavailable = false;
+
+QualityProber::QualityProber(QObject *parent) :
+    QObject(parent),
+    host(QStringLiteral("ipv4.jolla.com")),
+    port(80),
+    burst(3),
+    resolving(false)
+{
+}
+
+QualityProber::~QualityProber()
+{
+}
+
+void QualityProber::setEndpoint(const QString &endpointHost, quint16 endpointPort)
+{
+    if (host != endpointHost)
+        address.clear();
+    host = endpointHost;
+    port = endpointPort;
+}
+
+void QualityProber::setBurst(int count)
+{
+    burst = qMax(1, count);
+}
+
+void QualityProber::probe(const QString &key, const QString &interface, int count)
+{
+    // unbound, the probe would measure whatever link has the default route
+    if (bursts.contains(key) || interface.isEmpty() || bindingUnavailable)
+        return;
+
+    Burst b;
+    b.interface = interface.toLocal8Bit();
+    b.count = count > 0 ? count : burst;
+    b.remaining = b.count;
+    bursts.insert(key, b);
+
+    if (address.isNull()) {
+        resolve();
+        return;
+    }
+    connectNext(key);
+}
+
+bool QualityProber::isProbing(const QString &key) const
+{
+    return bursts.contains(key);
+}
+
+void QualityProber::watch(NetworkService *service)
+{
+    const QString path = service->path();
+    if (watches.contains(path))
+        return;
+
+    Watch w;
+    w.service = service;
+    w.interval = MinProbeInterval;
+    w.timer = new QTimer(this);
+    w.timer->setSingleShot(true);
+    w.timer->setProperty("key", path);
+    connect(w.timer, &QTimer::timeout, this, &QualityProber::periodicProbe);
+    watches.insert(path, w);
+
+    const QString iface = interfaceOf(service);
+    if (iface.isEmpty())
+        w.timer->start(w.interval);
+    else
+        probe(path, iface);
+}
+
+void QualityProber::unwatch(const QString &path)
+{
+    Watch w = watches.take(path);
+    delete w.timer;
+}
+
+void QualityProber::retain(const QStringList &paths)
+{
+    for (QHash<QString, Result>::iterator it = results.begin(); it != results.end();) {
+        if (paths.contains(it.key()))
+            ++it;
+        else
+            it = results.erase(it);
+    }
+    for (const QString &path : watches.keys()) {
+        if (!paths.contains(path))
+            unwatch(path);
+    }
+    results.squeeze();
+    watches.squeeze();
+}
+
+QualityProber::Result QualityProber::result(const QString &key) const
+{
+    return results.value(key);
+}
+
+QVariantMap QualityProber::toVariantMap() const
+{
+    QVariantMap map;
+    for (QHash<QString, Result>::const_iterator it = results.constBegin(); it != results.constEnd(); ++it) {
+        QVariantMap r;
+        r.insert(QStringLiteral("Rtt"), it->rtt);
+        r.insert(QStringLiteral("Loss"), it->loss);
+        r.insert(QStringLiteral("Samples"), it->samples);
+        r.insert(QStringLiteral("MeasuredAt"), it->measuredAt);
+        r.insert(QStringLiteral("Quality"), quality(it.value()));
+        map.insert(it.key(), r);
+    }
+    return map;
+}
+
+qreal QualityProber::quality(const Result &result)
+{
+    if (result.samples == 0)
+        return 0.5;
+    if (result.rtt < 0)
+        return 0;
+
+    // 50 ms or better counts as perfect, a second or worse as unusable
+    qreal rttFactor = qBound<qreal>(0, 1 - (result.rtt - 50) / 950.0, 1);
+    return (1 - result.loss) * rttFactor;
+}
+
+QString QualityProber::interfaceOf(NetworkService *service)
+{
+    return service->ethernet().value(QStringLiteral("Interface")).toString();
+}
+
+bool QualityProber::isAvailable()
+{
+    return !bindingUnavailable;
+}
+
+bool QualityProber::bindToInterface(QAbstractSocket *socket, const QByteArray &interface)
+{
+    if (bindingUnavailable)
+        return false;
+
+    QHostAddress local;
+    const QNetworkInterface netif = QNetworkInterface::interfaceFromName(QString::fromLocal8Bit(interface));
+    for (const QNetworkAddressEntry &entry : netif.addressEntries()) {
+        if (entry.ip().protocol() == QAbstractSocket::IPv4Protocol) {
+            local = entry.ip();
+            break;
+        }
+    }
+    // not configured yet, nothing to measure
+    if (local.isNull())
+        return false;
+
+    if (!socket->bind(local)) {
+        // an address that just went away is not the binding's fault
+        if (deviceBinding == DeviceBindingDenied
+                && socket->error() != QAbstractSocket::SocketAddressNotAvailableError) {
+            bindingUnavailable = true;
+            qCInfo(connAgent) << "Cannot bind sockets to interfaces, link quality probing disabled:"
+                              << socket->errorString();
+        }
+        return false;
+    }
+    if (deviceBinding == DeviceBindingDenied)
+        return true;
+
+    if (setsockopt(socket->socketDescriptor(), SOL_SOCKET, SO_BINDTODEVICE,
+                   interface.constData(), interface.size()) == 0) {
+        deviceBinding = DeviceBindingAllowed;
+        return true;
+    }
+    if (errno == EPERM && deviceBinding == DeviceBindingUnknown) {
+        deviceBinding = DeviceBindingDenied;
+        qCInfo(connAgent) << "Binding to a device is not permitted, probes are bound to interface addresses";
+        return true;
+    }
+    qCDebug(connAgent) << "Cannot bind to" << interface << ":" << strerror(errno);
+    return false;
+}
+
+void QualityProber::periodicProbe()
+{
+    TRACE_FUNCTION();
+    const QString key = sender()->property("key").toString();
+    const Watch w = watches.value(key);
+    if (!w.service)
+        return;
+
+    const QString iface = interfaceOf(w.service);
+    if (iface.isEmpty())
+        w.timer->start(w.interval);
+    else
+        probe(key, iface);
+}
+
+void QualityProber::resolve()
+{
+    if (resolving)
+        return;
+
+    // resolved once, so that the lookup is not part of any measurement
+    resolving = true;
+    QHostInfo::lookupHost(host, this, SLOT(hostResolved(QHostInfo)));
+}
+
+void QualityProber::hostResolved(const QHostInfo &info)
+{
+    TRACE_FUNCTION();
+    resolving = false;
+    for (const QHostAddress &candidate : info.addresses()) {
+        if (candidate.protocol() == QAbstractSocket::IPv4Protocol) {
+            address = candidate;
+            break;
+        }
+    }
+
+    const QStringList waiting = bursts.keys();
+    if (address.isNull()) {
+        qCWarning(connAgent) << "Cannot resolve probe endpoint" << host << ":" << info.errorString();
+        for (const QString &key : waiting)
+            probeFailed(key);
+        return;
+    }
+
+    for (const QString &key : waiting) {
+        if (!bursts.value(key).socket)
+            connectNext(key);
+    }
+}
+
+void QualityProber::probeFailed(const QString &key)
+{
+    bursts.remove(key);
+
+    // no measurement, but a watched service is tried again later
+    QHash<QString, Watch>::iterator it = watches.find(key);
+    if (it != watches.end()) {
+        it->interval = qMin(it->interval * 2, MaxProbeInterval);
+        it->timer->start(it->interval);
+    }
+}
+
+void QualityProber::connectNext(const QString &key)
+{
+    Burst &b = bursts[key];
+
+    QTcpSocket *socket = new QTcpSocket(this);
+    // not a measurement, the link may just not be configured yet
+    if (!bindToInterface(socket, b.interface)) {
+        delete socket;
+        probeFailed(key);
+        return;
+    }
+    b.socket = socket;
+
+    connect(socket, &QTcpSocket::connected, this, [this, key, socket]() {
+        if (bursts.value(key).socket == socket)
+            attemptDone(key, true);
+    });
+    connect(socket, static_cast<void (QAbstractSocket::*)(QAbstractSocket::SocketError)>(&QAbstractSocket::error),
+            this, [this, key, socket]() {
+        if (bursts.value(key).socket == socket)
+            attemptDone(key, false);
+    });
+    QTimer::singleShot(ConnectTimeout, socket, [this, key, socket]() {
+        if (bursts.value(key).socket == socket)
+            attemptDone(key, false);
+    });
+
+    b.clock.start();
+    socket->connectToHost(address, port);
+}
+
+void QualityProber::attemptDone(const QString &key, bool success)
+{
+    Burst &b = bursts[key];
+    qint64 rtt = b.clock.elapsed();
+
+    b.socket->disconnect(this);
+    b.socket->abort();
+    b.socket->deleteLater();
+    b.socket = nullptr;
+
+    if (success) {
+        b.successes++;
+        b.rttSum += rtt;
+    }
+
+    if (--b.remaining > 0) {
+        connectNext(key);
+        return;
+    }
+
+    Result r;
+    r.samples = b.count;
+    r.loss = 1 - qreal(b.successes) / b.count;
+    r.rtt = b.successes ? b.rttSum / b.successes : -1;
+    r.measuredAt = QDateTime::currentMSecsSinceEpoch();
+    bursts.remove(key);
+
+    const Result previous = results.value(key);
+    results.insert(key, r);
+    rescheduled(key, previous, r);
+
+    qCDebug(connAgent) << "Quality of" << key << "rtt" << r.rtt << "ms, loss" << r.loss;
+    Q_EMIT measured(key, r.rtt, r.loss);
+}
+
+void QualityProber::rescheduled(const QString &key, const Result &previous, const Result &current)
+{
+    QHash<QString, Watch>::iterator it = watches.find(key);
+    if (it == watches.end())
+        return;
+
+    bool stable = previous.samples > 0 && qAbs(previous.loss - current.loss) < 0.34
+            && previous.rtt >= 0 && current.rtt >= 0
+            && qAbs(previous.rtt - current.rtt) * 4 <= previous.rtt;
+
+    it->interval = stable ? qMin(it->interval * 2, MaxProbeInterval) : MinProbeInterval;
+    it->timer->start(it->interval);
+}
@@ -0,0 +1,128 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QUALITYPROBER_H
+#define QUALITYPROBER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QHostAddress>
+#include <QPointer>
+#include <QStringList>
+#include <QVariantMap>
+
+class QAbstractSocket;
+class QHostInfo;
+class QTcpSocket;
+class QTimer;
+class NetworkService;
+
+/*
+ * Measures round trip time and loss of a network interface with a short
+ * burst of TCP connects to a probe endpoint. The sockets are bound to the
+ * interface, so each service is measured on its own link regardless of the
+ * default route; a service without an interface is not probed. Binding to
+ * the device needs CAP_NET_RAW before Linux 5.7, without it the sockets are
+ * bound to the interface's IPv4 address only, and when even that is not
+ * possible probing is turned off. The
+ * endpoint is resolved once, so name lookups are not measured. Watched
+ * services are re-probed periodically, backing off while the results stay
+ * stable.
+ */
+class QualityProber : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Result {
+        Result() : rtt(-1), loss(0), samples(0), measuredAt(0) {}
+
+        qint64 rtt;         // mean connect time in ms, -1 when nothing got through
+        qreal loss;         // fraction of failed connects in the last burst
+        int samples;
+        qint64 measuredAt;  // msecs since epoch
+    };
+
+    explicit QualityProber(QObject *parent = 0);
+    ~QualityProber();
+
+    void setEndpoint(const QString &host, quint16 port);
+    void setBurst(int count);
+
+    // count 0 uses the configured burst
+    void probe(const QString &key, const QString &interface, int count = 0);
+    bool isProbing(const QString &key) const;
+
+    void watch(NetworkService *service);
+    void unwatch(const QString &path);
+    // Drops results and watches of services not in paths
+    void retain(const QStringList &paths);
+
+    Result result(const QString &key) const;
+    QVariantMap toVariantMap() const;
+
+    // 0 (unusable) to 1 (good), 0.5 when not measured
+    static qreal quality(const Result &result);
+    static QString interfaceOf(NetworkService *service);
+    // False when the socket cannot be tied to the interface, see above
+    static bool bindToInterface(QAbstractSocket *socket, const QByteArray &interface);
+    static bool isAvailable();
+
+Q_SIGNALS:
+    void measured(const QString &key, qint64 rtt, qreal loss);
+
+private slots:
+    void periodicProbe();
+    void hostResolved(const QHostInfo &info);
+
+private:
+    struct Burst {
+        Burst() : socket(nullptr), count(0), remaining(0), successes(0), rttSum(0) {}
+
+        QByteArray interface;
+        QTcpSocket *socket;
+        QElapsedTimer clock;
+        int count;
+        int remaining;
+        int successes;
+        qint64 rttSum;
+    };
+
+    struct Watch {
+        Watch() : timer(nullptr), interval(0) {}
+
+        QPointer<NetworkService> service;
+        QTimer *timer;
+        int interval;
+    };
+
+    void resolve();
+    void probeFailed(const QString &key);
+    void connectNext(const QString &key);
+    void attemptDone(const QString &key, bool success);
+    void rescheduled(const QString &key, const Result &previous, const Result &current);
+
+    QString host;
+    quint16 port;
+    int burst;
+    QHostAddress address;
+    bool resolving;
+    QHash<QString, Burst> bursts;
+    QHash<QString, Result> results;
+    QHash<QString, Watch> watches;
+};
+
+#endif // QUALITYPROBER_H
@@ -0,0 +1,181 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "retryscheduler.h"
+#include "tracing.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QLoggingCategory>
+
+#include <limits>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+// failures older than this no longer count
+static const qint64 FailureWindow = 60 * 60 * 1000;
+static const int MaxFailures = 16;
+
+RetryScheduler::RetryScheduler(QObject *parent) :
+    QObject(parent),
+    initial(30 * 1000),
+    maximum(30 * 60 * 1000),
+    random(std::random_device()())
+{
+    timer.setSingleShot(true);
+    connect(&timer, &QTimer::timeout, this, &RetryScheduler::expire);
+}
+
+RetryScheduler::~RetryScheduler()
+{
+}
+
+void RetryScheduler::setBackoff(int initialMsecs, int maximumMsecs)
+{
+    initial = initialMsecs;
+    maximum = qMax(initialMsecs, maximumMsecs);
+}
+
+qint64 RetryScheduler::backoff(int failures, int initial, int maximum)
+{
+    if (failures <= 0)
+        return 0;
+    return qMin<qint64>(qint64(initial) << qMin(failures - 1, 20), maximum);
+}
+
+void RetryScheduler::recordState(NetworkService *service, NetworkService::ServiceState state)
+{
+    const QString path = service->path();
+
+    if (state == NetworkService::OnlineState) {
+        if (entries.remove(path))
+            scheduleNext();
+        return;
+    }
+    if (state != NetworkService::FailureState)
+        return;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    Entry &entry = entries[path];
+    while (!entry.failures.isEmpty()
+           && (now - entry.failures.first() > FailureWindow || entry.failures.count() >= MaxFailures)) {
+        entry.failures.removeFirst();
+    }
+    entry.failures.append(now);
+
+    // up to 25% either way
+    qint64 delay = backoff(entry.failures.count(), initial, maximum);
+    delay += (delay / 4) * std::uniform_int_distribution<int>(-100, 100)(random) / 100;
+    entry.until = now + delay;
+
+    qCInfo(connAgent) << path << "failed" << entry.failures.count() << "times recently, quarantined for"
+                      << delay / 1000 << "s";
+    scheduleNext();
+}
+
+bool RetryScheduler::isQuarantined(const QString &path) const
+{
+    QHash<QString, Entry>::const_iterator it = entries.constFind(path);
+    return it != entries.constEnd() && it->until > QDateTime::currentMSecsSinceEpoch();
+}
+
+void RetryScheduler::release(const QString &path)
+{
+    QHash<QString, Entry>::iterator it = entries.find(path);
+    if (it == entries.end())
+        return;
+
+    // keep the failure history, a manual attempt should not reset the backoff
+    it->until = 0;
+    scheduleNext();
+}
+
+QVariantMap RetryScheduler::toVariantMap() const
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QVariantMap map;
+    for (QHash<QString, Entry>::const_iterator it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        QVariantMap entry;
+        entry.insert(QStringLiteral("Failures"), it->failures.count());
+        entry.insert(QStringLiteral("Quarantined"), it->until > now);
+        entry.insert(QStringLiteral("RetryIn"), qMax<qint64>(0, it->until - now));
+        map.insert(it.key(), entry);
+    }
+    return map;
+}
+
+QByteArray RetryScheduler::saveState() const
+{
+    QByteArray state;
+    QDataStream out(&state, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << quint32(entries.count());
+    for (QHash<QString, Entry>::const_iterator it = entries.constBegin(); it != entries.constEnd(); ++it)
+        out << it.key() << it->failures << it->until;
+    return state;
+}
+
+void RetryScheduler::restoreState(const QByteArray &state)
+{
+    QDataStream in(state);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 count = 0;
+    in >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString path;
+        Entry entry;
+        in >> path >> entry.failures >> entry.until;
+        if (in.status() == QDataStream::Ok && !entries.contains(path))
+            entries.insert(path, entry);
+    }
+    // deadlines that passed meanwhile expire right away
+    scheduleNext();
+}
+
+void RetryScheduler::expire()
+{
+    TRACE_FUNCTION();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QStringList due;
+    for (QHash<QString, Entry>::iterator it = entries.begin(); it != entries.end();) {
+        if (it->until && it->until <= now) {
+            due << it.key();
+            it->until = 0;
+        }
+        if (!it->until && !it->failures.isEmpty() && now - it->failures.last() > FailureWindow)
+            it = entries.erase(it);
+        else
+            ++it;
+    }
+
+    scheduleNext();
+    for (const QString &path : due)
+        Q_EMIT retryDue(path);
+}
+
+void RetryScheduler::scheduleNext()
+{
+    qint64 next = std::numeric_limits<qint64>::max();
+    for (const Entry &entry : entries) {
+        if (entry.until)
+            next = qMin(next, entry.until);
+    }
+
+    if (next == std::numeric_limits<qint64>::max()) {
+        timer.stop();
+        return;
+    }
+    timer.start(int(qBound<qint64>(0, next - QDateTime::currentMSecsSinceEpoch(), maximum)));
+}
@@ -0,0 +1,82 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef RETRYSCHEDULER_H
+#define RETRYSCHEDULER_H
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
+
+#include <random>
+
+#include "networkservice.h"
+
+/*
+ * Keeps services that keep failing to connect out of rotation for a while.
+ * Each failure within the failure window doubles the quarantine time, with
+ * some jitter so several broken services are not retried in lockstep. When
+ * the quarantine of a service runs out retryDue() is emitted once.
+ */
+class RetryScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RetryScheduler(QObject *parent = 0);
+    ~RetryScheduler();
+
+    void setBackoff(int initialMsecs, int maximumMsecs);
+
+    void recordState(NetworkService *service, NetworkService::ServiceState state);
+    bool isQuarantined(const QString &path) const;
+    void release(const QString &path);
+
+    QVariantMap toVariantMap() const;
+
+    // Failure history and quarantine deadlines, for carrying over a restart
+    QByteArray saveState() const;
+    void restoreState(const QByteArray &state);
+
+    // quarantine time after the given number of recent failures, without jitter
+    static qint64 backoff(int failures, int initial, int maximum);
+
+Q_SIGNALS:
+    void retryDue(const QString &path);
+
+private slots:
+    void expire();
+
+private:
+    struct Entry {
+        Entry() : until(0) {}
+
+        QVector<qint64> failures;   // msecs since epoch, oldest first
+        qint64 until;
+    };
+
+    void scheduleNext();
+
+    int initial;
+    int maximum;
+    QHash<QString, Entry> entries;
+    QTimer timer;
+    // own generator, the global qrand() state belongs to the application
+    std::mt19937 random;
+};
+
+#endif // RETRYSCHEDULER_H
@@ -0,0 +1,167 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "scanpredictor.h"
+#include "tracing.h"
+
+#include <QLoggingCategory>
+#include <QSettings>
+#include <QStandardPaths>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+static const int MaxCells = 512;
+static const int MaxNetworksPerCell = 16;
+// every n-th scan in an unknown cell is still made
+static const int ExploreEvery = 6;
+// a join this soon after a suggested scan counts as a correct prediction
+static const qint64 PredictionWindow = 2 * 60 * 1000;
+
+ScanPredictor::ScanPredictor(const QString &fileName, QObject *parent) :
+    QObject(parent),
+    storeFileName(fileName),
+    loaded(false),
+    predictionPending(false),
+    suppressedInRow(0),
+    predictions(0),
+    hits(0),
+    scansSaved(0)
+{
+    if (storeFileName.isEmpty()) {
+        storeFileName = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+                + QStringLiteral("/cells.ini");
+    }
+}
+
+ScanPredictor::~ScanPredictor()
+{
+}
+
+void ScanPredictor::load()
+{
+    if (loaded)
+        return;
+    loaded = true;
+
+    QSettings store(storeFileName, QSettings::IniFormat);
+    const QStringList stored = store.value(QStringLiteral("order")).toStringList();
+    QStringList order;
+    store.beginGroup(QStringLiteral("cells"));
+    for (const QString &cell : stored) {
+        // anything learned before the load is newer than what was stored
+        if (networksByCell.contains(cell))
+            continue;
+        networksByCell.insert(cell, store.value(cell).toStringList());
+        order.append(cell);
+    }
+    cellOrder = order + cellOrder;
+}
+
+QString ScanPredictor::cell() const
+{
+    return currentCell;
+}
+
+QStringList ScanPredictor::networks(const QString &cell) const
+{
+    return networksByCell.value(cell);
+}
+
+void ScanPredictor::setCell(const QString &key)
+{
+    TRACE_FUNCTION();
+    currentCell = key;
+    suppressedInRow = 0;
+
+    predictionPending = false;
+    if (networksByCell.contains(key)) {
+        qCDebug(connAgent) << "Cell" << key << "has known networks" << networksByCell.value(key);
+        Q_EMIT scanSuggested();
+    }
+}
+
+void ScanPredictor::scanIssued()
+{
+    // only a suggestion that led to a scan counts as a prediction
+    predictions++;
+    predictionPending = true;
+    lastPrediction.start();
+}
+
+void ScanPredictor::learn(const QString &servicePath)
+{
+    if (currentCell.isEmpty())
+        return;
+
+    if (predictionPending && lastPrediction.elapsed() < PredictionWindow
+            && networksByCell.value(currentCell).contains(servicePath)) {
+        hits++;
+    }
+    predictionPending = false;
+
+    QStringList &networks = networksByCell[currentCell];
+    if (networks.contains(servicePath))
+        return;
+
+    networks.prepend(servicePath);
+    if (networks.count() > MaxNetworksPerCell)
+        networks.removeLast();
+
+    cellOrder.removeOne(currentCell);
+    cellOrder.append(currentCell);
+    while (cellOrder.count() > MaxCells)
+        networksByCell.remove(cellOrder.takeFirst());
+
+    qCDebug(connAgent) << "Learned" << servicePath << "in cell" << currentCell;
+    save();
+}
+
+bool ScanPredictor::shouldSuppressScan()
+{
+    // without cell information, or in a cell with known networks, scan as before
+    if (currentCell.isEmpty() || networksByCell.contains(currentCell))
+        return false;
+
+    if (++suppressedInRow % ExploreEvery == 0)
+        return false;
+
+    scansSaved++;
+    return true;
+}
+
+QVariantMap ScanPredictor::statistics() const
+{
+    QVariantMap stats;
+    stats.insert(QStringLiteral("Cell"), currentCell);
+    stats.insert(QStringLiteral("KnownCells"), networksByCell.count());
+    stats.insert(QStringLiteral("Predictions"), predictions);
+    stats.insert(QStringLiteral("Hits"), hits);
+    stats.insert(QStringLiteral("Precision"), predictions ? qreal(hits) / predictions : 0.0);
+    stats.insert(QStringLiteral("ScansSaved"), scansSaved);
+    return stats;
+}
+
+void ScanPredictor::save()
+{
+    if (!loaded)
+        return;
+
+    QSettings store(storeFileName, QSettings::IniFormat);
+    store.clear();
+    store.setValue(QStringLiteral("order"), cellOrder);
+    store.beginGroup(QStringLiteral("cells"));
+    for (const QString &cell : cellOrder)
+        store.setValue(cell, networksByCell.value(cell));
+}
@@ -0,0 +1,77 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef SCANPREDICTOR_H
+#define SCANPREDICTOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QStringList>
+#include <QVariantMap>
+
+/*
+ * Learns in which cellular cells favourite Wifi networks have been joined.
+ * Entering such a cell suggests an immediate Wifi scan; in a cell with no
+ * known network the periodic scan is skipped, apart from an occasional
+ * exploratory one so that new places can still be learned.
+ */
+class ScanPredictor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ScanPredictor(const QString &fileName = QString(), QObject *parent = 0);
+    ~ScanPredictor();
+
+    // Reads the learned cells; the constructor does not touch the disk
+    void load();
+
+    QString cell() const;
+    QStringList networks(const QString &cell) const;
+
+    // A favourite Wifi network was joined while in the current cell
+    void learn(const QString &servicePath);
+    // The scan suggested on entering the cell was made
+    void scanIssued();
+    // Asked before each periodic scan, true when it should be skipped
+    bool shouldSuppressScan();
+
+    QVariantMap statistics() const;
+
+public slots:
+    void setCell(const QString &key);
+
+Q_SIGNALS:
+    void scanSuggested();
+
+private:
+    void save();
+
+    QString storeFileName;
+    bool loaded;
+    QString currentCell;
+    QHash<QString, QStringList> networksByCell;
+    QStringList cellOrder;
+
+    bool predictionPending;
+    QElapsedTimer lastPrediction;
+    int suppressedInRow;
+    quint32 predictions;
+    quint32 hits;
+    quint32 scansSaved;
+};
+
+#endif // SCANPREDICTOR_H
@@ -0,0 +1,383 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "servicehistory.h"
+#include "tracing.h"
+
+#include <connman-qt5/networkservice.h>
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+static const quint32 HistoryMagic = 0x43414831; // "CAH1"
+static const int MaxServices = 128;
+static const int MaxErrorKinds = 8;
+static const qint64 MaxAge = qint64(90) * 24 * 60 * 60 * 1000;
+static const qint64 MaxLogSize = 64 * 1024;
+static const int CompactInterval = 60 * 60 * 1000;
+// used for services we know nothing about, so they sort after proven ones
+static const qint64 UnknownOnlineTime = 10 * 1000;
+
+static QDataStream &operator<<(QDataStream &out, const ServiceHistory::Entry &entry)
+{
+    out << entry.attempts << entry.successes << entry.failures << entry.errors;
+    for (int i = 0; i < ServiceHistory::OnlineTimeBuckets; ++i)
+        out << entry.onlineTime[i];
+    return out << entry.lastSeen;
+}
+
+static QDataStream &operator>>(QDataStream &in, ServiceHistory::Entry &entry)
+{
+    in >> entry.attempts >> entry.successes >> entry.failures >> entry.errors;
+    for (int i = 0; i < ServiceHistory::OnlineTimeBuckets; ++i)
+        in >> entry.onlineTime[i];
+    return in >> entry.lastSeen;
+}
+
+ServiceHistory::ServiceHistory(const QString &fileName, QObject *parent) :
+    QObject(parent),
+    logFileName(fileName),
+    loaded(false)
+{
+    if (logFileName.isEmpty()) {
+        logFileName = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+                + QStringLiteral("/history");
+    }
+
+    compactTimer.setInterval(CompactInterval);
+    connect(&compactTimer, &QTimer::timeout, this, &ServiceHistory::compact);
+    compactTimer.start();
+}
+
+ServiceHistory::~ServiceHistory()
+{
+    compact();
+}
+
+QString ServiceHistory::fileName() const
+{
+    return logFileName;
+}
+
+int ServiceHistory::onlineTimeBucket(qint64 msecs)
+{
+    int bucket = 0;
+    while (bucket < OnlineTimeBuckets - 1 && msecs >= onlineTimeBucketLimit(bucket))
+        ++bucket;
+    return bucket;
+}
+
+qint64 ServiceHistory::onlineTimeBucketLimit(int bucket)
+{
+    // 500 ms, 1 s, 2 s ... 32 s, and everything slower
+    return bucket < OnlineTimeBuckets - 1 ? qint64(500) << bucket : -1;
+}
+
+void ServiceHistory::recordState(NetworkService *service, NetworkService::ServiceState state)
+{
+    const QString path = service->path();
+    Entry &e = entries[path];
+    e.lastSeen = QDateTime::currentMSecsSinceEpoch();
+
+    switch (state) {
+    case NetworkService::AssociationState:
+    case NetworkService::ConfigurationState:
+        if (!attempts.contains(path)) {
+            attempts[path].start();
+            e.attempts++;
+            append(AttemptRecord, path);
+        }
+        break;
+    case NetworkService::ReadyState:
+    case NetworkService::OnlineState:
+        if (attempts.contains(path)) {
+            qint64 elapsed = attempts.take(path).elapsed();
+            e.successes++;
+            e.onlineTime[onlineTimeBucket(elapsed)]++;
+            append(OnlineRecord, path, elapsed);
+        }
+        break;
+    case NetworkService::FailureState:
+        // losing an established link is not a failed connect attempt
+        if (attempts.remove(path) > 0) {
+            QString error = service->error();
+            if (error.isEmpty())
+                error = QStringLiteral("unknown");
+            e.failures++;
+            if (e.errors.contains(error) || e.errors.count() < MaxErrorKinds)
+                e.errors[error]++;
+            else
+                e.errors[QStringLiteral("other")]++;
+            append(FailureRecord, path, 0, error);
+        }
+        break;
+    default:
+        // aborted attempt, neither a success nor a failure
+        attempts.remove(path);
+        break;
+    }
+}
+
+void ServiceHistory::seen(const QString &path)
+{
+    // kept in memory only, written out with the next compaction
+    QHash<QString, Entry>::iterator it = entries.find(path);
+    if (it != entries.end())
+        it->lastSeen = QDateTime::currentMSecsSinceEpoch();
+}
+
+ServiceHistory::Entry ServiceHistory::entry(const QString &path) const
+{
+    return entries.value(path);
+}
+
+qreal ServiceHistory::successRate(const QString &path) const
+{
+    const Entry e = entries.value(path);
+    quint32 outcomes = e.successes + e.failures;
+    return outcomes ? qreal(e.successes) / outcomes : -1;
+}
+
+qint64 ServiceHistory::medianOnlineTime(const QString &path) const
+{
+    const Entry e = entries.value(path);
+    if (e.successes == 0)
+        return -1;
+
+    quint32 seen = 0;
+    for (int i = 0; i < OnlineTimeBuckets; ++i) {
+        seen += e.onlineTime[i];
+        if (seen * 2 >= e.successes) {
+            qint64 limit = onlineTimeBucketLimit(i);
+            return limit > 0 ? limit : onlineTimeBucketLimit(OnlineTimeBuckets - 2) * 2;
+        }
+    }
+    return -1;
+}
+
+qint64 ServiceHistory::expectedOnlineTime(const QString &path) const
+{
+    qint64 median = medianOnlineTime(path);
+    qreal rate = successRate(path);
+    if (median < 0 || rate < 0)
+        return rate == 0 ? UnknownOnlineTime * 4 : UnknownOnlineTime;
+
+    // on average 1/rate attempts are needed
+    return qint64(median / qMax<qreal>(rate, 0.1));
+}
+
+void ServiceHistory::sortByExpectedOnlineTime(QVector<NetworkService *> *services) const
+{
+    std::stable_sort(services->begin(), services->end(),
+                     [this](NetworkService *a, NetworkService *b) {
+        return expectedOnlineTime(a->path()) < expectedOnlineTime(b->path());
+    });
+}
+
+QVariantMap ServiceHistory::toVariantMap() const
+{
+    QVariantMap result;
+    for (QHash<QString, Entry>::const_iterator it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        const Entry &e = it.value();
+
+        QVariantMap errors;
+        for (QHash<QString, quint32>::const_iterator err = e.errors.constBegin(); err != e.errors.constEnd(); ++err)
+            errors.insert(err.key(), err.value());
+
+        QVariantList onlineTime;
+        for (int i = 0; i < OnlineTimeBuckets; ++i)
+            onlineTime << e.onlineTime[i];
+
+        QVariantMap service;
+        service.insert(QStringLiteral("Attempts"), e.attempts);
+        service.insert(QStringLiteral("Successes"), e.successes);
+        service.insert(QStringLiteral("Failures"), e.failures);
+        service.insert(QStringLiteral("Errors"), errors);
+        service.insert(QStringLiteral("OnlineTime"), onlineTime);
+        service.insert(QStringLiteral("MedianOnlineTime"), medianOnlineTime(it.key()));
+        service.insert(QStringLiteral("LastSeen"), e.lastSeen);
+        result.insert(it.key(), service);
+    }
+    return result;
+}
+
+void ServiceHistory::compact()
+{
+    TRACE_FUNCTION();
+    // never rewrite the file with what little was seen before it was read
+    if (!loaded)
+        return;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    QVector<QPair<qint64, QString> > byAge;
+    for (QHash<QString, Entry>::const_iterator it = entries.constBegin(); it != entries.constEnd(); ++it)
+        byAge << qMakePair(it->lastSeen, it.key());
+    std::sort(byAge.begin(), byAge.end());
+
+    for (int i = 0; i < byAge.count(); ++i) {
+        if (now - byAge.at(i).first > MaxAge || byAge.count() - i > MaxServices)
+            entries.remove(byAge.at(i).second);
+    }
+
+    log.close();
+
+    QSaveFile file(logFileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(connAgent) << "Cannot write connection history" << logFileName;
+        return;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << HistoryMagic;
+    for (QHash<QString, Entry>::const_iterator it = entries.constBegin(); it != entries.constEnd(); ++it)
+        out << quint8(SnapshotRecord) << it.key() << it.value();
+
+    if (!file.commit())
+        qCWarning(connAgent) << "Cannot write connection history" << logFileName;
+}
+
+void ServiceHistory::load()
+{
+    if (loaded)
+        return;
+    loaded = true;
+    QDir().mkpath(QFileInfo(logFileName).absolutePath());
+
+    QFile file(logFileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0;
+    in >> magic;
+    if (magic != HistoryMagic) {
+        qCWarning(connAgent) << "Ignoring unknown connection history format in" << logFileName;
+        file.close();
+        compact();
+        return;
+    }
+
+    bool truncated = false;
+    while (!in.atEnd()) {
+        quint8 type = 0;
+        QString path;
+        in >> type >> path;
+
+        Entry entry;
+        qint64 time = 0;
+        qint64 value = 0;
+        QString error;
+
+        switch (type) {
+        case SnapshotRecord:
+            in >> entry;
+            break;
+        case AttemptRecord:
+            in >> time;
+            break;
+        case OnlineRecord:
+            in >> time >> value;
+            break;
+        case FailureRecord:
+            in >> time >> error;
+            break;
+        default:
+            in.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+
+        if (in.status() != QDataStream::Ok) {
+            // a crash can leave a partial record at the end
+            truncated = true;
+            break;
+        }
+
+        Entry &e = entries[path];
+        switch (type) {
+        case SnapshotRecord:
+            e = entry;
+            break;
+        case AttemptRecord:
+            e.attempts++;
+            break;
+        case OnlineRecord:
+            e.successes++;
+            e.onlineTime[onlineTimeBucket(value)]++;
+            break;
+        case FailureRecord:
+            e.failures++;
+            if (e.errors.contains(error) || e.errors.count() < MaxErrorKinds)
+                e.errors[error]++;
+            else
+                e.errors[QStringLiteral("other")]++;
+            break;
+        }
+        e.lastSeen = qMax(e.lastSeen, time);
+    }
+
+    qCDebug(connAgent) << "Loaded connection history of" << entries.count() << "services";
+    if (truncated || file.size() > MaxLogSize) {
+        file.close();
+        compact();
+    }
+}
+
+void ServiceHistory::append(RecordType type, const QString &path, qint64 value, const QString &error)
+{
+    if (!loaded || !openLog())
+        return;
+
+    QDataStream out(&log);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << quint8(type) << path << QDateTime::currentMSecsSinceEpoch();
+    if (type == OnlineRecord)
+        out << value;
+    else if (type == FailureRecord)
+        out << error;
+    log.flush();
+
+    if (log.size() > MaxLogSize)
+        compact();
+}
+
+bool ServiceHistory::openLog()
+{
+    if (log.isOpen())
+        return true;
+
+    bool exists = QFile::exists(logFileName);
+    log.setFileName(logFileName);
+    if (!log.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qCWarning(connAgent) << "Cannot open connection history" << logFileName;
+        return false;
+    }
+    if (!exists || log.size() == 0) {
+        QDataStream out(&log);
+        out.setVersion(QDataStream::Qt_5_0);
+        out << HistoryMagic;
+    }
+    return true;
+}
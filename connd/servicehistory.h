@@ -0,0 +1,102 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef SERVICEHISTORY_H
+#define SERVICEHISTORY_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
+
+#include "networkservice.h"
+
+/*
+ * Per-service connection history that survives restarts. Every connect
+ * attempt, its outcome and the time it took to come up are appended to a
+ * log file; the log is periodically rewritten as one compact record per
+ * service, dropping services not seen for a long time.
+ */
+class ServiceHistory : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum { OnlineTimeBuckets = 8 };
+
+    struct Entry {
+        Entry() : attempts(0), successes(0), failures(0), lastSeen(0)
+        {
+            for (int i = 0; i < OnlineTimeBuckets; ++i)
+                onlineTime[i] = 0;
+        }
+
+        quint32 attempts;
+        quint32 successes;
+        quint32 failures;
+        QHash<QString, quint32> errors;
+        quint32 onlineTime[OnlineTimeBuckets];
+        qint64 lastSeen;    // msecs since epoch
+    };
+
+    explicit ServiceHistory(const QString &fileName = QString(), QObject *parent = 0);
+    ~ServiceHistory();
+
+    QString fileName() const;
+    // Reads the history; the constructor does not touch the disk
+    void load();
+
+    void recordState(NetworkService *service, NetworkService::ServiceState state);
+    void seen(const QString &path);
+
+    Entry entry(const QString &path) const;
+    qreal successRate(const QString &path) const;
+    // Median time from the start of a connect attempt to Ready, -1 if unknown
+    qint64 medianOnlineTime(const QString &path) const;
+    // Expected wait until the service is up, penalising unreliable ones
+    qint64 expectedOnlineTime(const QString &path) const;
+    void sortByExpectedOnlineTime(QVector<NetworkService *> *services) const;
+
+    QVariantMap toVariantMap() const;
+
+    static int onlineTimeBucket(qint64 msecs);
+    static qint64 onlineTimeBucketLimit(int bucket);
+
+public slots:
+    void compact();
+
+private:
+    enum RecordType {
+        SnapshotRecord = 1,
+        AttemptRecord,
+        OnlineRecord,
+        FailureRecord
+    };
+
+    void append(RecordType type, const QString &path, qint64 value = 0, const QString &error = QString());
+    bool openLog();
+
+    QString logFileName;
+    bool loaded;
+    QFile log;
+    QHash<QString, Entry> entries;
+    QHash<QString, QElapsedTimer> attempts;
+    QTimer compactTimer;
+};
+
+#endif // SERVICEHISTORY_H
@@ -0,0 +1,126 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "sleepwatcher.h"
+#include "tracing.h"
+
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+#define LOGIND_PATH "/org/freedesktop/login1"
+#define LOGIND_MANAGER "org.freedesktop.login1.Manager"
+
+// give up on the resume measurement when not online again within this
+static const qint64 ResumeWindow = 5 * 60 * 1000;
+
+SleepWatcher::SleepWatcher(QObject *parent) :
+    QObject(parent),
+    bus(QDBusConnection::systemBus()),
+    suspends(0),
+    resumesOnline(0),
+    lastResumeToOnline(0),
+    maxResumeToOnline(0),
+    totalResumeToOnline(0)
+{
+}
+
+SleepWatcher::~SleepWatcher()
+{
+}
+
+void SleepWatcher::watchLogind(const QDBusConnection &connection, const QString &service)
+{
+    bus = connection;
+    logindService = service;
+    bus.connect(logindService, QStringLiteral(LOGIND_PATH), QStringLiteral(LOGIND_MANAGER),
+                QStringLiteral("PrepareForSleep"), this, SLOT(prepareForSleep(bool)));
+    inhibit();
+}
+
+bool SleepWatcher::isResuming() const
+{
+    return resumeClock.isValid() && resumeClock.elapsed() < ResumeWindow;
+}
+
+void SleepWatcher::online()
+{
+    if (!resumeClock.isValid())
+        return;
+
+    if (resumeClock.elapsed() < ResumeWindow) {
+        lastResumeToOnline = resumeClock.elapsed();
+        maxResumeToOnline = qMax(maxResumeToOnline, lastResumeToOnline);
+        totalResumeToOnline += lastResumeToOnline;
+        resumesOnline++;
+        qCInfo(connAgent) << "Online" << lastResumeToOnline << "ms after resume";
+    }
+    resumeClock.invalidate();
+}
+
+QVariantMap SleepWatcher::statistics() const
+{
+    QVariantMap stats;
+    stats.insert(QStringLiteral("Suspends"), suspends);
+    stats.insert(QStringLiteral("ResumesOnline"), resumesOnline);
+    stats.insert(QStringLiteral("LastResumeToOnline"), lastResumeToOnline);
+    stats.insert(QStringLiteral("MaxResumeToOnline"), maxResumeToOnline);
+    stats.insert(QStringLiteral("AverageResumeToOnline"),
+                 resumesOnline ? totalResumeToOnline / resumesOnline : 0);
+    return stats;
+}
+
+void SleepWatcher::prepareForSleep(bool sleeping)
+{
+    TRACE_FUNCTION();
+    if (sleeping) {
+        suspends++;
+        resumeClock.invalidate();
+        Q_EMIT aboutToSleep();
+        // done, let the system suspend
+        inhibitor = QDBusUnixFileDescriptor();
+    } else {
+        resumeClock.start();
+        Q_EMIT resumed();
+        inhibit();
+    }
+}
+
+void SleepWatcher::inhibit()
+{
+    QDBusMessage call = QDBusMessage::createMethodCall(logindService, QStringLiteral(LOGIND_PATH),
+                                                       QStringLiteral(LOGIND_MANAGER),
+                                                       QStringLiteral("Inhibit"));
+    call << QStringLiteral("sleep") << QStringLiteral("connectionagent")
+         << QStringLiteral("Pausing connection timers") << QStringLiteral("delay");
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(bus.asyncCall(call), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, &SleepWatcher::inhibitReceived);
+}
+
+void SleepWatcher::inhibitReceived(QDBusPendingCallWatcher *call)
+{
+    TRACE_FUNCTION();
+    call->deleteLater();
+    QDBusPendingReply<QDBusUnixFileDescriptor> reply = *call;
+    if (reply.isError()) {
+        // still get the signal, just without the guarantee to run before suspend
+        qCDebug(connAgent) << "No sleep inhibitor:" << reply.error().message();
+        return;
+    }
+    inhibitor = reply.value();
+}
@@ -0,0 +1,74 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef SLEEPWATCHER_H
+#define SLEEPWATCHER_H
+
+#include <QObject>
+#include <QDBusConnection>
+#include <QDBusUnixFileDescriptor>
+#include <QElapsedTimer>
+#include <QVariantMap>
+
+class QDBusPendingCallWatcher;
+
+/*
+ * Follows system suspend through logind's PrepareForSleep signal. A delay
+ * inhibitor is held while awake so aboutToSleep() handlers get to run
+ * before the system goes down. Also measures how long it takes to get
+ * back online after each resume.
+ */
+class SleepWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SleepWatcher(QObject *parent = 0);
+    ~SleepWatcher();
+
+    // logind on the system bus by default, any service implementing
+    // org.freedesktop.login1.Manager will do
+    void watchLogind(const QDBusConnection &bus = QDBusConnection::systemBus(),
+                     const QString &service = QStringLiteral("org.freedesktop.login1"));
+
+    bool isResuming() const;
+    void online();
+
+    QVariantMap statistics() const;
+
+Q_SIGNALS:
+    void aboutToSleep();
+    void resumed();
+
+private slots:
+    void prepareForSleep(bool sleeping);
+    void inhibitReceived(QDBusPendingCallWatcher *call);
+
+private:
+    void inhibit();
+
+    QDBusConnection bus;
+    QString logindService;
+    QDBusUnixFileDescriptor inhibitor;
+    QElapsedTimer resumeClock;
+
+    quint32 suspends;
+    quint32 resumesOnline;
+    qint64 lastResumeToOnline;
+    qint64 maxResumeToOnline;
+    qint64 totalResumeToOnline;
+};
+
+#endif // SLEEPWATCHER_H
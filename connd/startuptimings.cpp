@@ -0,0 +1,125 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+
+#include "startuptimings.h"
+
+#include <QFile>
+#include <QLoggingCategory>
+
+#include <time.h>
+#include <unistd.h>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+// Milliseconds between exec and now, from the start time in /proc/self/stat
+static qint64 processAge()
+{
+    QFile stat(QStringLiteral("/proc/self/stat"));
+    if (!stat.open(QIODevice::ReadOnly))
+        return -1;
+
+    // the command name may contain spaces, fields are counted after it
+    const QByteArray line = stat.readAll();
+    const QList<QByteArray> fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+    if (fields.count() < 20)
+        return -1;
+
+    const qint64 startTicks = fields.at(19).toLongLong();
+    struct timespec now;
+    clock_gettime(CLOCK_BOOTTIME, &now);
+    const qint64 uptime = qint64(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+    return uptime - startTicks * 1000 / sysconf(_SC_CLK_TCK);
+}
+
+StartupTimings *StartupTimings::instance()
+{
+    static StartupTimings timings;
+    return &timings;
+}
+
+StartupTimings::StartupTimings() :
+    beforeMain(-1),
+    boosted(false),
+    readyAt(-1)
+{
+    clock.start();
+}
+
+void StartupTimings::start()
+{
+    clock.start();
+    beforeMain = processAge();
+}
+
+void StartupTimings::setBoosted(bool isBoosted)
+{
+    boosted = isBoosted;
+    // the process was forked from the booster long before, its age says nothing
+    if (boosted)
+        beforeMain = -1;
+}
+
+void StartupTimings::begin(const char *phase)
+{
+    Entry entry = { phase, clock.elapsed(), -1 };
+    entries.append(entry);
+}
+
+void StartupTimings::end(const char *phase)
+{
+    for (int i = entries.count() - 1; i >= 0; --i) {
+        Entry &entry = entries[i];
+        if (entry.duration < 0 && qstrcmp(entry.name, phase) == 0) {
+            entry.duration = clock.elapsed() - entry.start;
+            return;
+        }
+    }
+}
+
+void StartupTimings::ready()
+{
+    if (readyAt >= 0)
+        return;
+
+    readyAt = clock.elapsed();
+    qCInfo(connAgent) << "Ready" << readyAt << "ms after main," << beforeMain << "ms spent before main";
+    for (const Entry &entry : entries)
+        qCDebug(connAgent) << "  " << entry.name << "at" << entry.start << "ms took" << entry.duration << "ms";
+}
+
+bool StartupTimings::isReady() const
+{
+    return readyAt >= 0;
+}
+
+QVariantMap StartupTimings::toVariantMap() const
+{
+    QVariantList phases;
+    for (const Entry &entry : entries) {
+        QVariantMap phase;
+        phase.insert(QStringLiteral("Name"), QString::fromLatin1(entry.name));
+        phase.insert(QStringLiteral("Start"), entry.start);
+        phase.insert(QStringLiteral("Duration"), entry.duration);
+        phases << phase;
+    }
+
+    QVariantMap timings;
+    timings.insert(QStringLiteral("BeforeMain"), beforeMain);
+    timings.insert(QStringLiteral("Boosted"), boosted);
+    timings.insert(QStringLiteral("Ready"), readyAt);
+    timings.insert(QStringLiteral("Phases"), phases);
+    return timings;
+}
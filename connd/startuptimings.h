@@ -0,0 +1,76 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+
+#ifndef STARTUPTIMINGS_H
+#define STARTUPTIMINGS_H
+
+#include <QElapsedTimer>
+#include <QVariantMap>
+#include <QVector>
+
+/*
+ * Wall clock timings of the startup phases, relative to main(), kept for
+ * the life of the process so they can be queried over D-Bus. The time the
+ * process spent before main() (loading and relocating libraries) is taken
+ * from /proc, and is unknown (-1) for boosted runs.
+ */
+class StartupTimings
+{
+public:
+    static StartupTimings *instance();
+
+    // To be called first thing in main()
+    void start();
+    // The application came preinitialised from the booster
+    void setBoosted(bool boosted);
+
+    void begin(const char *phase);
+    void end(const char *phase);
+    // The agent answers requests and knows the connman services
+    void ready();
+    bool isReady() const;
+
+    QVariantMap toVariantMap() const;
+
+    class Phase
+    {
+    public:
+        explicit Phase(const char *name) : m_name(name) { StartupTimings::instance()->begin(m_name); }
+        ~Phase() { StartupTimings::instance()->end(m_name); }
+
+    private:
+        Q_DISABLE_COPY(Phase)
+
+        const char *m_name;
+    };
+
+private:
+    StartupTimings();
+
+    struct Entry {
+        const char *name;
+        qint64 start;
+        qint64 duration;    // -1 while running
+    };
+
+    QElapsedTimer clock;
+    QVector<Entry> entries;
+    qint64 beforeMain;
+    bool boosted;
+    qint64 readyAt;
+};
+
+#endif // STARTUPTIMINGS_H
@@ -0,0 +1,338 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "tetheringstatemachine.h"
+#include "eventjournal.h"
+#include "tracing.h"
+
+#include <connman-qt5/networktechnology.h>
+#include <connman-qt5/networkservice.h>
+
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+// connman may still be bringing the wifi interface up when it reports the
+// technology powered, in which case the tethering request is dropped.
+static const int TetheringRetryInterval = 500;
+static const int MaxTetheringRequests = 6;
+static const int DefaultTimeout = 30 * 1000;
+
+static bool isUplinkReady(NetworkService::ServiceState state)
+{
+    return state == NetworkService::OnlineState || state == NetworkService::ReadyState;
+}
+
+TetheringStateMachine::TetheringStateMachine(QObject *parent) :
+    QObject(parent),
+    currentState(Idle),
+    conditions(0),
+    tetheringRequests(0),
+    uplinkRequested(false)
+{
+    deadline.setSingleShot(true);
+    deadline.setInterval(DefaultTimeout);
+    connect(&deadline, &QTimer::timeout, this, &TetheringStateMachine::deadlineExpired);
+
+    retryTimer.setSingleShot(true);
+    retryTimer.setInterval(TetheringRetryInterval);
+    connect(&retryTimer, &QTimer::timeout, this, &TetheringStateMachine::retryTethering);
+}
+
+TetheringStateMachine::~TetheringStateMachine()
+{
+}
+
+TetheringStateMachine::State TetheringStateMachine::state() const
+{
+    return currentState;
+}
+
+bool TetheringStateMachine::isStarting() const
+{
+    return currentState != Idle && currentState != Active;
+}
+
+bool TetheringStateMachine::isRunning() const
+{
+    return currentState != Idle;
+}
+
+NetworkTechnology *TetheringStateMachine::technology() const
+{
+    return wifiTech.data();
+}
+
+NetworkService *TetheringStateMachine::uplink() const
+{
+    return uplinkService.data();
+}
+
+bool TetheringStateMachine::uplinkBroughtUp() const
+{
+    return uplinkRequested;
+}
+
+void TetheringStateMachine::setUplink(NetworkService *uplink, bool broughtUp)
+{
+    if (uplinkService == uplink)
+        return;
+
+    if (uplinkService)
+        uplinkService->disconnect(this);
+    uplinkService = uplink;
+    uplinkRequested = broughtUp;
+    if (uplink)
+        connect(uplink, &NetworkService::serviceStateChanged,
+                this, &TetheringStateMachine::uplinkStateChanged);
+}
+
+void TetheringStateMachine::setTimeout(int msecs)
+{
+    deadline.setInterval(msecs > 0 ? msecs : DefaultTimeout);
+}
+
+int TetheringStateMachine::timeout() const
+{
+    return deadline.interval();
+}
+
+QVariantMap TetheringStateMachine::lastBringUp() const
+{
+    return phases;
+}
+
+void TetheringStateMachine::start(NetworkTechnology *wifi, NetworkService *uplink)
+{
+    if (isRunning())
+        stop();
+
+    wifiTech = wifi;
+    uplinkService = uplink;
+    conditions = 0;
+    tetheringRequests = 0;
+    uplinkRequested = false;
+    phases.clear();
+    clock.start();
+
+    connect(wifi, &NetworkTechnology::poweredChanged,
+            this, &TetheringStateMachine::technologyPoweredChanged);
+    connect(wifi, &NetworkTechnology::tetheringChanged,
+            this, &TetheringStateMachine::technologyTetheringChanged);
+    connect(uplink, &NetworkService::serviceStateChanged,
+            this, &TetheringStateMachine::uplinkStateChanged);
+
+    setState(PoweringUp);
+    deadline.start();
+
+    // Both legs run in parallel: the uplink does not depend on Wifi at all
+    if (isUplinkReady(uplink->serviceState())) {
+        reached(UplinkReady);
+    } else if (uplink->serviceState() == NetworkService::IdleState
+               || uplink->serviceState() == NetworkService::FailureState
+               || uplink->serviceState() == NetworkService::DisconnectState) {
+        qCInfo(connAgent) << "Requesting cell connect";
+        uplinkRequested = true;
+        EventJournal::request(EventJournal::Connect, uplink->path());
+        TRACE_CALL("requestConnect", uplink->requestConnect());
+    }
+
+    if (wifi->tethering()) {
+        reached(WifiPowered);
+        reached(TetheringOn);
+    } else if (wifi->powered()) {
+        reached(WifiPowered);
+    } else {
+        EventJournal::request(EventJournal::PowerOn, wifi->type());
+        TRACE_CALL("setPowered", wifi->setPowered(true));
+    }
+
+    advance();
+}
+
+void TetheringStateMachine::stop()
+{
+    deadline.stop();
+    retryTimer.stop();
+    disconnectSources();
+    wifiTech.clear();
+    uplinkService.clear();
+    conditions = 0;
+    setState(Idle);
+}
+
+void TetheringStateMachine::technologyPoweredChanged(bool powered)
+{
+    TRACE_FUNCTION();
+    if (currentState == Active) {
+        if (!powered)
+            fail("wifi powered off");
+        return;
+    }
+    if (!isStarting())
+        return;
+
+    if (powered) {
+        reached(WifiPowered);
+    } else {
+        conditions &= ~(WifiPowered | TetheringOn);
+    }
+    advance();
+}
+
+void TetheringStateMachine::technologyTetheringChanged(bool on)
+{
+    TRACE_FUNCTION();
+    if (currentState == Active) {
+        if (!on)
+            fail("tethering turned off");
+        return;
+    }
+    if (!isStarting())
+        return;
+
+    if (on) {
+        retryTimer.stop();
+        reached(TetheringOn);
+    } else {
+        conditions &= ~TetheringOn;
+    }
+    advance();
+}
+
+void TetheringStateMachine::uplinkStateChanged(NetworkService::ServiceState state)
+{
+    TRACE_FUNCTION();
+    if (currentState == Active) {
+        if (state == NetworkService::FailureState)
+            fail("cellular uplink lost");
+        return;
+    }
+    if (!isStarting())
+        return;
+
+    if (isUplinkReady(state)) {
+        reached(UplinkReady);
+        advance();
+    } else if (state == NetworkService::FailureState) {
+        fail("cellular uplink failed");
+    }
+}
+
+void TetheringStateMachine::retryTethering()
+{
+    TRACE_FUNCTION();
+    if (currentState != EnablingTethering)
+        return;
+
+    if (tetheringRequests >= MaxTetheringRequests) {
+        fail("technology did not enable tethering");
+        return;
+    }
+    requestTethering();
+}
+
+void TetheringStateMachine::deadlineExpired()
+{
+    TRACE_FUNCTION();
+    if (isStarting())
+        fail("timed out");
+}
+
+void TetheringStateMachine::reached(Condition condition)
+{
+    if (conditions & condition)
+        return;
+
+    conditions |= condition;
+
+    const char *name = condition == WifiPowered ? "wifiPowered"
+                     : condition == TetheringOn ? "tetheringEnabled"
+                     : "uplinkReady";
+    phases.insert(QLatin1String(name), clock.elapsed());
+}
+
+void TetheringStateMachine::advance()
+{
+    if (!isStarting())
+        return;
+
+    if (!(conditions & WifiPowered)) {
+        setState(PoweringUp);
+    } else if (!(conditions & TetheringOn)) {
+        if (currentState != EnablingTethering) {
+            setState(EnablingTethering);
+            requestTethering();
+        }
+    } else if (!(conditions & UplinkReady)) {
+        setState(WaitingForUplink);
+    } else {
+        deadline.stop();
+        retryTimer.stop();
+        phases.insert(QStringLiteral("total"), clock.elapsed());
+        phases.insert(QStringLiteral("success"), true);
+        qCInfo(connAgent) << "Wifi tethering up, phases (ms):" << phases;
+        setState(Active);
+        Q_EMIT finished(true);
+    }
+}
+
+void TetheringStateMachine::setState(State newState)
+{
+    if (currentState == newState)
+        return;
+
+    qCDebug(connAgent) << "Tethering" << currentState << "->" << newState;
+    currentState = newState;
+    Q_EMIT stateChanged(newState);
+}
+
+void TetheringStateMachine::fail(const char *reason)
+{
+    if (currentState == Active) {
+        // the phases of the bring-up stay as they were
+        qCWarning(connAgent) << "Wifi tethering stopped after" << clock.elapsed() << "ms:" << reason;
+        stop();
+        Q_EMIT finished(false);
+        return;
+    }
+
+    phases.insert(QStringLiteral("total"), clock.elapsed());
+    phases.insert(QStringLiteral("success"), false);
+    qCWarning(connAgent) << "Wifi tethering failed in" << currentState << ":" << reason
+                         << "phases (ms):" << phases;
+    stop();
+    Q_EMIT finished(false);
+}
+
+void TetheringStateMachine::requestTethering()
+{
+    if (!wifiTech)
+        return;
+
+    ++tetheringRequests;
+    qCInfo(connAgent) << "Setting Wifi tethering on, attempt" << tetheringRequests;
+    EventJournal::request(EventJournal::TetheringOn, wifiTech->type());
+    TRACE_CALL("setTethering", wifiTech->setTethering(true));
+    retryTimer.start();
+}
+
+void TetheringStateMachine::disconnectSources()
+{
+    if (wifiTech)
+        wifiTech->disconnect(this);
+    if (uplinkService)
+        uplinkService->disconnect(this);
+}
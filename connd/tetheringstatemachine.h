@@ -0,0 +1,116 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef TETHERINGSTATEMACHINE_H
+#define TETHERINGSTATEMACHINE_H
+
+#include <QObject>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVariantMap>
+
+#include "networkservice.h"
+
+class NetworkTechnology;
+
+/*
+ * Drives Wifi tethering bring-up. Powering up the Wifi technology and
+ * connecting the cellular uplink are started at the same time; the
+ * tethering switch is flipped as soon as connman reports the technology
+ * powered. Each readiness condition is tracked separately and the state
+ * only moves forward on connman signals, so there are no fixed delays.
+ * A single deadline covers the whole bring-up. Once active, Wifi being
+ * powered off, tethering being turned off from elsewhere or the uplink
+ * failing ends tethering with finished(false).
+ */
+class TetheringStateMachine : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum State {
+        Idle,
+        PoweringUp,        // waiting for the Wifi technology to power up
+        EnablingTethering, // powered, tethering requested but not yet on
+        WaitingForUplink,  // tethering on, cellular uplink not yet connected
+        Active
+    };
+    Q_ENUM(State)
+
+    explicit TetheringStateMachine(QObject *parent = 0);
+    ~TetheringStateMachine();
+
+    State state() const;
+    bool isStarting() const;
+    bool isRunning() const;
+
+    NetworkTechnology *technology() const;
+    NetworkService *uplink() const;
+    // The uplink was connected for tethering, not by the user
+    bool uplinkBroughtUp() const;
+    // Follows an uplink switch while tethering is active
+    void setUplink(NetworkService *uplink, bool broughtUp);
+
+    void setTimeout(int msecs);
+    int timeout() const;
+
+    // Phase latencies of the last bring-up, in milliseconds since start()
+    QVariantMap lastBringUp() const;
+
+    void start(NetworkTechnology *wifi, NetworkService *uplink);
+    void stop();
+
+Q_SIGNALS:
+    void stateChanged(TetheringStateMachine::State state);
+    // Also emitted with false when active tethering is lost
+    void finished(bool success);
+
+private slots:
+    void technologyPoweredChanged(bool powered);
+    void technologyTetheringChanged(bool on);
+    void uplinkStateChanged(NetworkService::ServiceState state);
+    void retryTethering();
+    void deadlineExpired();
+
+private:
+    enum Condition {
+        WifiPowered = 0x1,
+        TetheringOn = 0x2,
+        UplinkReady = 0x4,
+        AllReady = WifiPowered | TetheringOn | UplinkReady
+    };
+
+    void reached(Condition condition);
+    void advance();
+    void setState(State newState);
+    void fail(const char *reason);
+    void requestTethering();
+    void disconnectSources();
+
+    QPointer<NetworkTechnology> wifiTech;
+    QPointer<NetworkService> uplinkService;
+    State currentState;
+    int conditions;
+    int tetheringRequests;
+    bool uplinkRequested;
+
+    QTimer deadline;
+    QTimer retryTimer;
+    QElapsedTimer clock;
+    QVariantMap phases;
+};
+
+#endif // TETHERINGSTATEMACHINE_H
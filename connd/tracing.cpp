@@ -0,0 +1,152 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "tracing.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+
+#include <atomic>
+
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// per thread, a power of two
+static const quint32 BufferSize = 16384;
+
+namespace {
+
+struct Event {
+    const char *name;
+    const char *category;
+    quint64 time;       // CLOCK_MONOTONIC in ns
+    char phase;
+};
+
+struct ThreadBuffer {
+    ThreadBuffer() : next(0), tid(::syscall(SYS_gettid)) {}
+
+    Event events[BufferSize];
+    std::atomic<quint32> next;
+    qint64 tid;
+};
+
+QMutex registryLock;
+QVector<ThreadBuffer *> registry;
+thread_local ThreadBuffer *threadBuffer = nullptr;
+
+ThreadBuffer *registerThread()
+{
+    // once per thread, buffers are kept for the life of the process so
+    // spans of finished threads can still be exported
+    ThreadBuffer *buffer = new ThreadBuffer;
+    QMutexLocker locker(&registryLock);
+    registry << buffer;
+    return buffer;
+}
+
+inline void record(const char *name, const char *category, char phase)
+{
+    ThreadBuffer *buffer = threadBuffer;
+    if (!buffer)
+        buffer = threadBuffer = registerThread();
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    const quint32 index = buffer->next.load(std::memory_order_relaxed);
+    Event &event = buffer->events[index & (BufferSize - 1)];
+    event.name = name;
+    event.category = category;
+    event.time = quint64(now.tv_sec) * 1000000000 + now.tv_nsec;
+    event.phase = phase;
+    buffer->next.store(index + 1, std::memory_order_release);
+}
+
+void appendString(QByteArray *json, const char *string)
+{
+    json->append('"');
+    for (const char *c = string; *c; ++c) {
+        if (*c == '"' || *c == '\\')
+            json->append('\\');
+        if (uchar(*c) >= 0x20)
+            json->append(*c);
+    }
+    json->append('"');
+}
+
+}
+
+bool Tracing::enabled = false;
+bool Tracing::watched = false;
+thread_local std::atomic<const char *> Tracing::current(nullptr);
+
+void Tracing::setEnabled(bool enable)
+{
+    enabled = enable;
+}
+
+void Tracing::setWatched(bool watch)
+{
+    watched = watch;
+}
+
+void Tracing::begin(const char *name, const char *category)
+{
+    record(name, category, 'B');
+}
+
+void Tracing::end(const char *name, const char *category)
+{
+    record(name, category, 'E');
+}
+
+std::atomic<const char *> *Tracing::currentSpan()
+{
+    return &current;
+}
+
+QByteArray Tracing::toJson()
+{
+    const qint64 pid = ::getpid();
+    QByteArray json("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first = true;
+
+    QMutexLocker locker(&registryLock);
+    for (ThreadBuffer *buffer : registry) {
+        const quint32 next = buffer->next.load(std::memory_order_acquire);
+        const quint32 count = qMin(next, BufferSize);
+        for (quint32 i = next - count; i != next; ++i) {
+            const Event &event = buffer->events[i & (BufferSize - 1)];
+            if (!first)
+                json.append(',');
+            first = false;
+
+            json.append("{\"name\":");
+            appendString(&json, event.name);
+            json.append(",\"cat\":");
+            appendString(&json, event.category);
+            json.append(",\"ph\":\"").append(event.phase).append('"');
+            json.append(",\"ts\":").append(QByteArray::number(event.time / 1000.0, 'f', 3));
+            json.append(",\"pid\":").append(QByteArray::number(pid));
+            json.append(",\"tid\":").append(QByteArray::number(buffer->tid));
+            json.append('}');
+        }
+    }
+    json.append("]}");
+    return json;
+}
@@ -0,0 +1,101 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+#include <atomic>
+
+/*
+ * Begin/end trace spans in Chrome trace event format, loadable in
+ * chrome://tracing and Perfetto. Spans are recorded into a fixed per-thread
+ * ring without locks; names and categories must be string literals. When
+ * tracing is off a span costs one well predicted branch, and building with
+ * CONFIG+=notracing removes them altogether.
+ *
+ * While setWatched(true) is in effect the name of the innermost open span
+ * of each thread is kept even with tracing off, so a watchdog can tell what
+ * a stalled thread is running.
+ *
+ *   TRACE_FUNCTION();                                  // span for the enclosing scope
+ *   TRACE_CALL("requestConnect", service->requestConnect());
+ */
+namespace Tracing {
+
+extern bool enabled;
+extern bool watched;
+extern thread_local std::atomic<const char *> current;
+
+void setEnabled(bool enable);
+void setWatched(bool watch);
+void begin(const char *name, const char *category);
+void end(const char *name, const char *category);
+QByteArray toJson();
+
+// The innermost span of the calling thread, safe to read from other threads
+std::atomic<const char *> *currentSpan();
+
+class Span
+{
+public:
+    Span(const char *name, const char *category)
+        : m_name(name), m_category(category), m_active(Q_UNLIKELY(enabled))
+        , m_named(Q_UNLIKELY(m_active || watched)), m_parent(nullptr)
+    {
+        if (Q_UNLIKELY(m_named)) {
+            m_parent = current.load(std::memory_order_relaxed);
+            current.store(m_name, std::memory_order_relaxed);
+            if (m_active)
+                begin(m_name, m_category);
+        }
+    }
+    ~Span()
+    {
+        if (Q_UNLIKELY(m_named)) {
+            current.store(m_parent, std::memory_order_relaxed);
+            if (m_active)
+                end(m_name, m_category);
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(Span)
+
+    const char *m_name;
+    const char *m_category;
+    bool m_active;
+    bool m_named;
+    const char *m_parent;
+};
+
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef CONNECTIONAGENT_NO_TRACING
+#define TRACE_SPAN(name, category) do {} while (0)
+#define TRACE_FUNCTION() do {} while (0)
+#define TRACE_CALL(name, call) do { call; } while (0)
+#else
+#define TRACE_SPAN(name, category) Tracing::Span TRACE_CONCAT(traceSpan, __LINE__)(name, category)
+#define TRACE_FUNCTION() TRACE_SPAN(Q_FUNC_INFO, "slot")
+#define TRACE_CALL(name, call) do { TRACE_SPAN(name, "dbus"); call; } while (0)
+#endif
+
+#endif // TRACING_H
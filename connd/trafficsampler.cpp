@@ -0,0 +1,194 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "trafficsampler.h"
+#include "tracing.h"
+
+#include <QLoggingCategory>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+static const int MaxSampleInterval = 30 * 1000;
+static const int MinSampleInterval = 1000;
+
+TrafficSampler::TrafficSampler(QObject *parent) :
+    QObject(parent),
+    interfaceName(QStringLiteral("tether")),
+    idleTimeoutMsecs(0),
+    started(false),
+    rxFd(-1),
+    txFd(-1),
+    haveBaseline(false),
+    countersMissing(false),
+    lastTotal(0),
+    transferred(0)
+{
+    connect(&timer, &QTimer::timeout, this, &TrafficSampler::sample);
+}
+
+TrafficSampler::~TrafficSampler()
+{
+    closeCounters();
+}
+
+void TrafficSampler::setInterface(const QString &name)
+{
+    if (interfaceName == name)
+        return;
+
+    interfaceName = name;
+    closeCounters();
+}
+
+QString TrafficSampler::interface() const
+{
+    return interfaceName;
+}
+
+void TrafficSampler::setIdleTimeout(int msecs)
+{
+    const bool wasDisabled = idleTimeoutMsecs == 0;
+    idleTimeoutMsecs = qMax(0, msecs);
+    // a few samples per idle period is enough, the counters only grow
+    timer.setInterval(qBound(MinSampleInterval, idleTimeoutMsecs / 4, MaxSampleInterval));
+
+    if (idleTimeoutMsecs == 0) {
+        timer.stop();
+        closeCounters();
+    } else if (wasDisabled && started) {
+        startSampling();
+    }
+}
+
+int TrafficSampler::idleTimeout() const
+{
+    return idleTimeoutMsecs;
+}
+
+void TrafficSampler::start()
+{
+    started = true;
+    if (idleTimeoutMsecs > 0)
+        startSampling();
+}
+
+void TrafficSampler::startSampling()
+{
+    haveBaseline = false;
+    countersMissing = false;
+    lastTotal = 0;
+    transferred = 0;
+    sinceActivity.start();
+    timer.start();
+    sample();
+}
+
+void TrafficSampler::stop()
+{
+    started = false;
+    timer.stop();
+    closeCounters();
+}
+
+bool TrafficSampler::isRunning() const
+{
+    return timer.isActive();
+}
+
+quint64 TrafficSampler::bytesTransferred() const
+{
+    return transferred;
+}
+
+qint64 TrafficSampler::idleTime() const
+{
+    return sinceActivity.isValid() ? sinceActivity.elapsed() : 0;
+}
+
+void TrafficSampler::sample()
+{
+    TRACE_FUNCTION();
+    quint64 rx = 0;
+    quint64 tx = 0;
+
+    // the interface can appear a moment after tethering is reported on,
+    // until then and while the counters cannot be read there is no traffic
+    if ((rxFd >= 0 && txFd >= 0) || openCounters()) {
+        if (readCounter(rxFd, &rx) && readCounter(txFd, &tx)) {
+            const quint64 total = rx + tx;
+            if (!haveBaseline) {
+                haveBaseline = true;
+            } else if (total != lastTotal) {
+                // a recreated interface starts counting from zero again
+                transferred += total > lastTotal ? total - lastTotal : total;
+                sinceActivity.restart();
+            }
+            lastTotal = total;
+            countersMissing = false;
+        } else {
+            // interface went away or was recreated, reopen on the next tick
+            closeCounters();
+        }
+    } else if (!countersMissing) {
+        countersMissing = true;
+        qCWarning(connAgent) << "No traffic counters for" << interfaceName << ", counting as idle";
+    }
+
+    if (idleTimeoutMsecs > 0 && sinceActivity.elapsed() >= idleTimeoutMsecs) {
+        timer.stop();
+        Q_EMIT idle(sinceActivity.elapsed(), bytesTransferred());
+    }
+}
+
+bool TrafficSampler::openCounters()
+{
+    closeCounters();
+
+    const QByteArray base = "/sys/class/net/" + interfaceName.toLocal8Bit() + "/statistics/";
+    rxFd = ::open((base + "rx_bytes").constData(), O_RDONLY | O_CLOEXEC);
+    txFd = ::open((base + "tx_bytes").constData(), O_RDONLY | O_CLOEXEC);
+
+    if (rxFd < 0 || txFd < 0) {
+        closeCounters();
+        return false;
+    }
+    return true;
+}
+
+void TrafficSampler::closeCounters()
+{
+    if (rxFd >= 0)
+        ::close(rxFd);
+    if (txFd >= 0)
+        ::close(txFd);
+    rxFd = -1;
+    txFd = -1;
+}
+
+bool TrafficSampler::readCounter(int fd, quint64 *value)
+{
+    // sysfs attributes are regenerated on every read from offset 0
+    ssize_t len = ::pread(fd, buffer, sizeof(buffer) - 1, 0);
+    if (len <= 0)
+        return false;
+
+    buffer[len] = '\0';
+    *value = strtoull(buffer, nullptr, 10);
+    return true;
+}
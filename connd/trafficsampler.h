@@ -0,0 +1,79 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef TRAFFICSAMPLER_H
+#define TRAFFICSAMPLER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+
+/*
+ * Samples the kernel rx/tx byte counters of a network interface and reports
+ * when no traffic has been seen for the idle timeout. The sysfs counter files
+ * are kept open and re-read into a fixed buffer, so a sample does not allocate.
+ * Counters that cannot be read count as no traffic.
+ */
+class TrafficSampler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TrafficSampler(QObject *parent = 0);
+    ~TrafficSampler();
+
+    void setInterface(const QString &name);
+    QString interface() const;
+
+    // 0 disables the idle report, also while started
+    void setIdleTimeout(int msecs);
+    int idleTimeout() const;
+
+    void start();
+    void stop();
+    bool isRunning() const;
+
+    quint64 bytesTransferred() const;
+    qint64 idleTime() const;
+
+Q_SIGNALS:
+    void idle(qint64 idleMsecs, quint64 bytesTransferred);
+
+private slots:
+    void sample();
+
+private:
+    void startSampling();
+    bool openCounters();
+    void closeCounters();
+    bool readCounter(int fd, quint64 *value);
+
+    QString interfaceName;
+    int idleTimeoutMsecs;
+    // start() was called, sampling runs whenever the idle timeout is set
+    bool started;
+    int rxFd;
+    int txFd;
+    bool haveBaseline;
+    bool countersMissing;
+    quint64 lastTotal;
+    quint64 transferred;
+    char buffer[32];
+
+    QTimer timer;
+    QElapsedTimer sinceActivity;
+};
+
+#endif // TRAFFICSAMPLER_H
@@ -0,0 +1,78 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "unixsignalnotifier.h"
+
+#include <QLoggingCategory>
+#include <QSocketNotifier>
+
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+static int signalFds[2] = { -1, -1 };
+
+UnixSignalNotifier *UnixSignalNotifier::instance()
+{
+    static UnixSignalNotifier *notifier = new UnixSignalNotifier;
+    return notifier;
+}
+
+UnixSignalNotifier::UnixSignalNotifier(QObject *parent) :
+    QObject(parent),
+    notifier(nullptr)
+{
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, signalFds) < 0) {
+        qCWarning(connAgent) << "Cannot create socket pair for Unix signals";
+        return;
+    }
+
+    notifier = new QSocketNotifier(signalFds[1], QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &UnixSignalNotifier::readSignal);
+}
+
+UnixSignalNotifier::~UnixSignalNotifier()
+{
+}
+
+bool UnixSignalNotifier::watch(int signum)
+{
+    if (!notifier)
+        return false;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = UnixSignalNotifier::handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    return sigaction(signum, &action, nullptr) == 0;
+}
+
+void UnixSignalNotifier::handler(int signum)
+{
+    const unsigned char c = signum;
+    if (::write(signalFds[0], &c, sizeof(c)) < 0)
+        return;
+}
+
+void UnixSignalNotifier::readSignal()
+{
+    unsigned char c;
+    if (::read(signalFds[1], &c, sizeof(c)) == sizeof(c))
+        Q_EMIT received(c);
+}
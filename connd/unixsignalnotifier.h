@@ -0,0 +1,52 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef UNIXSIGNALNOTIFIER_H
+#define UNIXSIGNALNOTIFIER_H
+
+#include <QObject>
+
+class QSocketNotifier;
+
+/*
+ * Delivers Unix signals as a Qt signal in the main event loop. The handler
+ * only writes the signal number to a socket pair, everything else happens
+ * when the event loop reads it back.
+ */
+class UnixSignalNotifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    static UnixSignalNotifier *instance();
+
+    bool watch(int signum);
+
+Q_SIGNALS:
+    void received(int signum);
+
+private slots:
+    void readSignal();
+
+private:
+    explicit UnixSignalNotifier(QObject *parent = 0);
+    ~UnixSignalNotifier();
+
+    static void handler(int signum);
+
+    QSocketNotifier *notifier;
+};
+
+#endif // UNIXSIGNALNOTIFIER_H
@@ -0,0 +1,316 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "uplinkselector.h"
+#include "eventjournal.h"
+#include "qualityprober.h"
+#include "tracing.h"
+
+#include <connman-qt5/networkservice.h>
+
+#include <QDateTime>
+#include <QFile>
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+static const int MonitorInterval = 60 * 1000;
+// costs are in milliseconds of round trip time
+static const qint64 UnknownRttCost = 800;
+static const qint64 NotConnectedCost = 1500;
+static const qint64 FailureCost = 1000;
+static const qint64 MaxThroughputCredit = 300;
+// below this the interface is considered idle and the rate is not sampled
+static const qreal MinCarryingRate = 1024;
+
+static bool isConnected(NetworkService *service)
+{
+    return service->serviceState() == NetworkService::OnlineState
+            || service->serviceState() == NetworkService::ReadyState;
+}
+
+UplinkSelector::UplinkSelector(QualityProber *prober, QObject *parent) :
+    QObject(parent),
+    prober(prober),
+    currentBroughtUp(false),
+    pendingBroughtUp(false),
+    currentAutoConnect(true),
+    pendingAutoConnect(true),
+    baselineRtt(-1)
+{
+    connect(prober, &QualityProber::measured, this, &UplinkSelector::probeFinished);
+
+    monitorTimer.setInterval(MonitorInterval);
+    connect(&monitorTimer, &QTimer::timeout, this, &UplinkSelector::reevaluate);
+}
+
+UplinkSelector::~UplinkSelector()
+{
+}
+
+void UplinkSelector::setCandidates(const QVector<NetworkService *> &services)
+{
+    for (const QPointer<NetworkService> &service : candidates) {
+        if (service)
+            disconnect(service.data(), &NetworkService::serviceStateChanged,
+                       this, &UplinkSelector::candidateStateChanged);
+    }
+    candidates.clear();
+
+    for (NetworkService *service : services) {
+        candidates << service;
+        connect(service, &NetworkService::serviceStateChanged,
+                this, &UplinkSelector::candidateStateChanged, Qt::UniqueConnection);
+
+        // services that are online have been measured by the shared prober
+        Stats &s = stats[service->path()];
+        const QualityProber::Result r = prober->result(service->path());
+        if (s.rtt < 0 && r.samples > 0 && r.rtt >= 0)
+            s.rtt = r.rtt;
+    }
+}
+
+qint64 UplinkSelector::cost(const Stats &stats, bool connected, QString *reason)
+{
+    qint64 total = stats.rtt >= 0 ? stats.rtt : UnknownRttCost;
+    if (!connected)
+        total += NotConnectedCost;
+    total += stats.failures * FailureCost;
+    // proven throughput buys up to MaxThroughputCredit, 1 ms per 10 kB/s
+    total -= qMin(qint64(stats.throughput / 10000), MaxThroughputCredit);
+
+    if (reason) {
+        *reason = QStringLiteral("rtt %1, %2, %3 failed probes, %4 kB/s")
+                .arg(stats.rtt >= 0 ? QString::number(stats.rtt) + QStringLiteral(" ms") : QStringLiteral("unknown"))
+                .arg(connected ? QStringLiteral("connected") : QStringLiteral("not connected"))
+                .arg(stats.failures)
+                .arg(qint64(stats.throughput / 1000));
+    }
+    return total;
+}
+
+NetworkService *UplinkSelector::best() const
+{
+    NetworkService *bestService = nullptr;
+    qint64 bestCost = 0;
+    QString bestReason;
+
+    // ties keep the candidate order, which is connman's own service order
+    for (const QPointer<NetworkService> &service : candidates) {
+        if (!service)
+            continue;
+
+        QString reason;
+        qint64 c = cost(stats.value(service->path()), isConnected(service), &reason);
+        qCDebug(connAgent) << "Uplink candidate" << service->path() << c << reason;
+        if (!bestService || c < bestCost) {
+            bestService = service;
+            bestCost = c;
+            bestReason = reason;
+        }
+    }
+
+    if (bestService)
+        qCInfo(connAgent) << "Uplink" << bestService->path() << "chosen, cost" << bestCost << ":" << bestReason;
+    return bestService;
+}
+
+NetworkService *UplinkSelector::current() const
+{
+    return currentUplink.data();
+}
+
+bool UplinkSelector::isBroughtUp() const
+{
+    return currentBroughtUp;
+}
+
+bool UplinkSelector::previousAutoConnect() const
+{
+    return currentAutoConnect;
+}
+
+void UplinkSelector::monitor(NetworkService *uplink, bool broughtUp)
+{
+    currentUplink = uplink;
+    currentBroughtUp = broughtUp;
+    currentAutoConnect = uplink ? uplink->autoConnect() : true;
+    pendingUplink.clear();
+    baselineRtt = uplink ? stats.value(uplink->path()).rtt : -1;
+    monitorTimer.start();
+    probeAll();
+}
+
+void UplinkSelector::stopMonitoring()
+{
+    monitorTimer.stop();
+    currentUplink.clear();
+    pendingUplink.clear();
+}
+
+void UplinkSelector::release()
+{
+    if (currentUplink)
+        return;
+
+    setCandidates(QVector<NetworkService *>());
+    candidates.squeeze();
+    stats.clear();
+}
+
+void UplinkSelector::probeAll()
+{
+    for (const QPointer<NetworkService> &service : candidates) {
+        if (service && isConnected(service))
+            probe(service);
+    }
+}
+
+void UplinkSelector::reevaluate()
+{
+    TRACE_FUNCTION();
+    if (!currentUplink)
+        return;
+
+    sampleThroughput(currentUplink);
+
+    const Stats &currentStats = stats[currentUplink->path()];
+    if (baselineRtt < 0)
+        baselineRtt = currentStats.rtt;
+
+    bool degraded = currentStats.failures >= 2 || !isConnected(currentUplink)
+            || (baselineRtt >= 0 && currentStats.rtt > qMax(2 * baselineRtt, baselineRtt + 300));
+
+    if (degraded && !pendingUplink) {
+        QString reason;
+        qint64 currentCost = cost(currentStats, isConnected(currentUplink), &reason);
+        qCInfo(connAgent) << "Uplink" << currentUplink->path() << "degraded:" << reason;
+
+        NetworkService *better = best();
+        if (better && better != currentUplink
+                && cost(stats.value(better->path()), isConnected(better)) < currentCost) {
+            switchTo(better);
+        }
+    }
+
+    probeAll();
+}
+
+void UplinkSelector::candidateStateChanged(NetworkService::ServiceState state)
+{
+    TRACE_FUNCTION();
+    NetworkService *service = static_cast<NetworkService *>(sender());
+    if (!service || !currentUplink)
+        return;
+
+    if (service == pendingUplink && isConnected(service)) {
+        completeSwitch();
+    } else if (service == pendingUplink && state == NetworkService::FailureState) {
+        qCInfo(connAgent) << "Uplink" << service->path() << "failed to come up";
+        stats[service->path()].failures++;
+        pendingUplink.clear();
+    } else if (service == currentUplink && state == NetworkService::FailureState) {
+        reevaluate();
+    }
+}
+
+void UplinkSelector::probe(NetworkService *service)
+{
+    // a recent measurement by the prober's own watch is as good as a new one
+    const QualityProber::Result r = prober->result(service->path());
+    if (r.samples > 0 && QDateTime::currentMSecsSinceEpoch() - r.measuredAt < MonitorInterval / 2) {
+        probeFinished(service->path(), r.rtt, r.loss);
+        return;
+    }
+
+    // one connect per probe is enough to rank, the monitor repeats it
+    prober->probe(service->path(), QualityProber::interfaceOf(service), 1);
+}
+
+void UplinkSelector::sampleThroughput(NetworkService *service)
+{
+    const QString base = QStringLiteral("/sys/class/net/") + QualityProber::interfaceOf(service) + QStringLiteral("/statistics/");
+    quint64 bytes = 0;
+    for (const char *counter : { "rx_bytes", "tx_bytes" }) {
+        QFile file(base + QLatin1String(counter));
+        if (!file.open(QIODevice::ReadOnly))
+            return;
+        bytes += file.readAll().trimmed().toULongLong();
+    }
+
+    Stats &s = stats[service->path()];
+    if (s.lastSample.isValid() && bytes >= s.lastBytes && s.lastSample.elapsed() > 0) {
+        qreal rate = (bytes - s.lastBytes) * 1000.0 / s.lastSample.elapsed();
+        if (rate >= MinCarryingRate)
+            s.throughput = s.throughput > 0 ? (3 * s.throughput + rate) / 4 : rate;
+    }
+    s.lastBytes = bytes;
+    s.lastSample.start();
+}
+
+void UplinkSelector::probeFinished(const QString &path, qint64 rtt, qreal loss)
+{
+    // the prober is shared, only candidates are of interest here
+    QHash<QString, Stats>::iterator it = stats.find(path);
+    if (it == stats.end())
+        return;
+
+    Stats &s = *it;
+    if (rtt < 0 || loss >= 1) {
+        s.failures++;
+        qCDebug(connAgent) << "Uplink probe failed for" << path << s.failures;
+    } else {
+        s.failures = 0;
+        s.rtt = s.rtt >= 0 ? (3 * s.rtt + rtt) / 4 : rtt;
+        qCDebug(connAgent) << "Uplink probe" << path << rtt << "ms, smoothed" << s.rtt;
+    }
+}
+
+void UplinkSelector::switchTo(NetworkService *better)
+{
+    qCInfo(connAgent) << "Switching uplink from" << currentUplink->path() << "to" << better->path();
+    pendingUplink = better;
+    pendingBroughtUp = !isConnected(better);
+    // connman may turn AutoConnect on when connecting, remember it from before
+    pendingAutoConnect = better->autoConnect();
+    // the old uplink is only dropped once the new one is up
+    if (isConnected(better)) {
+        completeSwitch();
+    } else {
+        EventJournal::request(EventJournal::Connect, better->path());
+        TRACE_CALL("requestConnect", better->requestConnect());
+    }
+}
+
+void UplinkSelector::completeSwitch()
+{
+    NetworkService *previous = currentUplink;
+    const bool previousBroughtUp = currentBroughtUp;
+    qCInfo(connAgent) << "Uplink" << pendingUplink->path() << "is up, leaving" << previous->path();
+    currentUplink = pendingUplink;
+    currentBroughtUp = pendingBroughtUp;
+    currentAutoConnect = pendingAutoConnect;
+    pendingUplink.clear();
+    baselineRtt = -1;
+    Q_EMIT uplinkChanged(currentUplink);
+
+    // only a cellular connection made for tethering is ours to drop, a wired
+    // or Bluetooth connection, or one the user made, is left alone
+    if (previous && previousBroughtUp && previous->type() == QLatin1String("cellular")) {
+        EventJournal::request(EventJournal::Disconnect, previous->path());
+        TRACE_CALL("requestDisconnect", previous->requestDisconnect());
+    }
+    probe(currentUplink);
+}
@@ -0,0 +1,103 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef UPLINKSELECTOR_H
+#define UPLINKSELECTOR_H
+
+#include <QObject>
+#include <QHash>
+#include <QPointer>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVector>
+
+#include "networkservice.h"
+
+class QualityProber;
+
+/*
+ * Picks the uplink for Wifi tethering among the cellular services and any
+ * other connected non-Wifi service. Candidates are ranked by the round trip
+ * time of a TCP connect to the probe endpoint, made through the candidate's
+ * own interface, and by the throughput seen on that interface while it was
+ * carrying traffic. While tethering runs the current uplink is re-probed and
+ * a better candidate is brought up before the degraded one is dropped. Only
+ * a cellular uplink that was connected for tethering is ever disconnected.
+ */
+class UplinkSelector : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats {
+        Stats() : rtt(-1), failures(0), throughput(0), lastBytes(0) {}
+
+        qint64 rtt;         // smoothed connect RTT in ms, -1 when unknown
+        int failures;       // consecutive failed probes
+        qreal throughput;   // smoothed bytes/s while carrying traffic
+        quint64 lastBytes;
+        QElapsedTimer lastSample;
+    };
+
+    // Probes through the given prober, which is shared with the owner
+    explicit UplinkSelector(QualityProber *prober, QObject *parent = 0);
+    ~UplinkSelector();
+
+    void setCandidates(const QVector<NetworkService *> &services);
+
+    // Cost of a candidate, lower is better. Exposed for ranking and logging.
+    static qint64 cost(const Stats &stats, bool connected, QString *reason = nullptr);
+
+    NetworkService *best() const;
+    NetworkService *current() const;
+    bool isBroughtUp() const;
+    // AutoConnect of the current uplink from before it was switched to
+    bool previousAutoConnect() const;
+
+    // broughtUp: the uplink was connected for tethering and may be dropped again
+    void monitor(NetworkService *uplink, bool broughtUp);
+    void stopMonitoring();
+    // Drops candidates and their stats while no uplink is monitored
+    void release();
+    void probeAll();
+
+Q_SIGNALS:
+    void uplinkChanged(NetworkService *uplink);
+
+private slots:
+    void reevaluate();
+    void candidateStateChanged(NetworkService::ServiceState state);
+
+private:
+    void probe(NetworkService *service);
+    void sampleThroughput(NetworkService *service);
+    void probeFinished(const QString &path, qint64 rtt, qreal loss);
+    void switchTo(NetworkService *better);
+    void completeSwitch();
+
+    QualityProber *prober;
+    QVector<QPointer<NetworkService> > candidates;
+    QHash<QString, Stats> stats;
+    QPointer<NetworkService> currentUplink;
+    QPointer<NetworkService> pendingUplink;
+    bool currentBroughtUp;
+    bool pendingBroughtUp;
+    bool currentAutoConnect;
+    bool pendingAutoConnect;
+    qint64 baselineRtt;
+    QTimer monitorTimer;
+};
+
+#endif // UPLINKSELECTOR_H
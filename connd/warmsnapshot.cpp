@@ -0,0 +1,109 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+
+#include "warmsnapshot.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+Q_DECLARE_LOGGING_CATEGORY(connAgent)
+
+static const quint32 SnapshotMagic = 0x43415331; // "CAS1"
+
+WarmSnapshot::WarmSnapshot() :
+    wifiTethering(false),
+    flightModeSuppression(false),
+    flightModeDeadline(0),
+    scanDeadline(0),
+    savedAt(0)
+{
+}
+
+bool WarmSnapshot::isValid() const
+{
+    return savedAt != 0;
+}
+
+bool WarmSnapshot::save(const QString &fileName) const
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(connAgent) << "Cannot write snapshot" << fileName;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << SnapshotMagic << QDateTime::currentMSecsSinceEpoch();
+    out << quint32(services.count());
+    for (const Service &service : services)
+        out << service.path << service.autoConnect;
+    out << wifiTethering << tetheringUplink << flightModeSuppression << flightModeDeadline
+        << scanDeadline << retryState;
+
+    if (!file.commit()) {
+        qCWarning(connAgent) << "Cannot write snapshot" << fileName;
+        return false;
+    }
+    return true;
+}
+
+bool WarmSnapshot::take(const QString &fileName, qint64 maxAge)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0;
+    qint64 time = 0;
+    quint32 count = 0;
+    in >> magic >> time >> count;
+
+    const qint64 age = QDateTime::currentMSecsSinceEpoch() - time;
+    bool ok = in.status() == QDataStream::Ok && magic == SnapshotMagic && age >= 0 && age <= maxAge;
+    for (quint32 i = 0; ok && i < count; ++i) {
+        Service service;
+        in >> service.path >> service.autoConnect;
+        services << service;
+        ok = in.status() == QDataStream::Ok;
+    }
+    if (ok) {
+        in >> wifiTethering >> tetheringUplink >> flightModeSuppression >> flightModeDeadline
+           >> scanDeadline >> retryState;
+        ok = in.status() == QDataStream::Ok;
+    }
+
+    file.remove();
+    if (!ok) {
+        qCInfo(connAgent) << "Ignoring stale or unreadable snapshot" << fileName;
+        *this = WarmSnapshot();
+        return false;
+    }
+    savedAt = time;
+    return true;
+}
+
+QString WarmSnapshot::defaultFileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation)
+            + QStringLiteral("/connectionagent-snapshot");
+}
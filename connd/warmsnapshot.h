@@ -0,0 +1,59 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+
+#ifndef WARMSNAPSHOT_H
+#define WARMSNAPSHOT_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+/*
+ * What the agent needs to carry on where it left off after a restart,
+ * written at a graceful shutdown into the runtime directory. Deadlines are
+ * wall clock time, so the time spent restarting is accounted for. A
+ * snapshot is used once and only when recent, connman stays the authority
+ * and everything is reconciled with it once the services are enumerated.
+ */
+class WarmSnapshot
+{
+public:
+    struct Service {
+        QString path;
+        bool autoConnect;
+    };
+
+    WarmSnapshot();
+
+    bool isValid() const;
+
+    bool save(const QString &fileName) const;
+    // Reads and removes the snapshot, ignoring it when older than maxAge msecs
+    bool take(const QString &fileName, qint64 maxAge);
+
+    static QString defaultFileName();
+
+    QVector<Service> services;      // in preference order
+    bool wifiTethering;             // tethering was up or being brought up
+    QString tetheringUplink;
+    bool flightModeSuppression;
+    qint64 flightModeDeadline;      // msecs since epoch, 0 if none
+    qint64 scanDeadline;            // msecs since epoch, 0 if none
+    QByteArray retryState;          // RetryScheduler::saveState()
+    qint64 savedAt;
+};
+
+#endif // WARMSNAPSHOT_H
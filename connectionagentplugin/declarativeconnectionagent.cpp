@@ -78,6 +78,8 @@ void DeclarativeConnectionAgent::connectToConnectiond()
             this, &DeclarativeConnectionAgent::bluetoothTetheringFinished);
     connect(connManagerInterface, &com::jolla::Connectiond::wifiTetheringFinished,
             this, &DeclarativeConnectionAgent::wifiTetheringFinished);
+    connect(connManagerInterface, &com::jolla::Connectiond::wifiTetheringIdleStopped,
+            this, &DeclarativeConnectionAgent::wifiTetheringIdleStopped);
 }
 
 void DeclarativeConnectionAgent::sendUserReply(const QVariantMap &input)
@@ -82,6 +82,7 @@ signals:
     void connectionState(const QString &state, const QString &type);
     void browserRequested(const QString &url, const QString &serviceName);
     void wifiTetheringFinished(bool);
+    void wifiTetheringIdleStopped(uint idleTime, qulonglong bytesTransferred);
     void bluetoothTetheringFinished(bool);
 
 private:
@@ -96,3 +96,5 @@ fi
 
 %files tracing
 %config /var/lib/environment/nemo/70-connectionagent-tracing.conf
+%{_bindir}/connectionagent-journal
+%{_bindir}/connectionagent-startupbench
@@ -23,23 +23,100 @@
 #include <QProcess>
 
 #include "../../../connd/qconnectionagent.h"
+#include "../../../connd/tetheringstatemachine.h"
+#include "../../../connd/trafficsampler.h"
+#include "../../../connd/uplinkselector.h"
+#include "../../../connd/migrationengine.h"
+#include "../../../connd/servicehistory.h"
+#include "../../../connd/connectrace.h"
+#include "../../../connd/scanpredictor.h"
+#include "../../../connd/handovercontroller.h"
+#include "../../../connd/qualityprober.h"
+#include "../../../connd/portalcache.h"
+#include "../../../connd/credentialprovider.h"
+#include "../../../connd/retryscheduler.h"
+#include "../../../connd/ethernetpowersave.h"
+#include "../../../connd/sleepwatcher.h"
+#include "../../../connd/metrics.h"
+#include "../../../connd/eventjournal.h"
+#include "../../../connd/tracing.h"
+#include "../../../connd/startuptimings.h"
+#include "../../../connd/warmsnapshot.h"
+#include "../../../connd/agentconfig.h"
+#include "../../../connd/connmanconfig.h"
+#include "../../../connd/idlereclaimer.h"
 
 #include <networkmanager.h>
 #include <networktechnology.h>
 #include <networkservice.h>
 
 
+static QVariantMap serviceProperties(const QString &type, const QString &state, int strength)
+{
+    QVariantMap properties;
+    properties.insert("Type", type);
+    properties.insert("State", state);
+    properties.insert("Strength", strength);
+    properties.insert("Favorite", true);
+    properties.insert("AutoConnect", true);
+    return properties;
+}
+
+// The agent under test must neither read nor replace the files of the
+// user's own agent, such as its settings, history or warm snapshot
+static bool isolateFromUserState(const QTemporaryDir &runtimeDir)
+{
+    QStandardPaths::setTestModeEnabled(true);
+    qputenv("XDG_RUNTIME_DIR", QFile::encodeName(runtimeDir.path()));
+    return runtimeDir.isValid();
+}
+
 class Tst_connectionagent : public QObject
 {
     Q_OBJECT
 
+public:
+    Tst_connectionagent() : isolated(isolateFromUserState(runtimeDir)) {}
+
 private Q_SLOTS:
+    void initTestCase();
     void tst_onErrorReported();
+    void tst_tetheringStateMachine();
+    void tst_trafficSampler();
+    void tst_uplinkCost();
+    void tst_migrationScore();
+    void tst_historyBuckets();
+    void tst_connectRace();
+    void tst_scanPrediction();
+    void tst_handover();
+    void tst_qualityScore();
+    void tst_portalCache();
+    void tst_credentialProvider();
+    void tst_retryScheduler();
+    void tst_ethernetPowerSave();
+    void tst_sleepWatcher();
+    void tst_metrics();
+    void tst_eventJournal();
+    void tst_tracing();
+    void tst_startupTimings();
+    void tst_warmSnapshot();
+    void tst_agentConfig();
+    void tst_connmanConfig();
+    void tst_idleReclaimer();
 
 private:
+    // declared before the agent, which resolves its paths when constructed
+    QTemporaryDir runtimeDir;
+    bool isolated;
     QConnectionAgent agent;
 };
 
+void Tst_connectionagent::initTestCase()
+{
+    QVERIFY(isolated);
+    QVERIFY(WarmSnapshot::defaultFileName().startsWith(runtimeDir.path()));
+}
+
 void Tst_connectionagent::tst_onErrorReported()
 {
     QSignalSpy spy(&agent, SIGNAL(errorReported(QString,QString)));
@@ -57,6 +134,789 @@ void Tst_connectionagent::tst_onErrorReported()
     QCOMPARE(arguments.at(0).toString(), QString(""));
     QCOMPARE(arguments.at(1).toString(), QString("Type not valid"));
 
+    // errors are counted by kind after suppression, unknown ones as other
+    agent.onErrorReported("test_path", "");
+    agent.onErrorReported("test_path", "invalid-key");
+    const QVariantMap counters = agent.GetMetrics().value("Counters").toMap();
+    QCOMPARE(counters.value("errors.invalid-key").toInt(), 1);
+    QCOMPARE(counters.value("errors.other").toInt(), 1);
+    QVERIFY(!counters.contains("errors."));
+    QVERIFY(!counters.contains("errors.Test error"));
+}
+
+void Tst_connectionagent::tst_tetheringStateMachine()
+{
+    NetworkTechnology wifi;
+    NetworkService uplink;
+    TetheringStateMachine machine;
+    QSignalSpy finished(&machine, SIGNAL(finished(bool)));
+
+    machine.start(&wifi, &uplink);
+    QCOMPARE(machine.state(), TetheringStateMachine::PoweringUp);
+    Q_EMIT wifi.poweredChanged(true);
+    QCOMPARE(machine.state(), TetheringStateMachine::EnablingTethering);
+    Q_EMIT wifi.tetheringChanged(true);
+    QCOMPARE(machine.state(), TetheringStateMachine::WaitingForUplink);
+    Q_EMIT uplink.serviceStateChanged(NetworkService::ReadyState);
+    QCOMPARE(machine.state(), TetheringStateMachine::Active);
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(finished.takeFirst().at(0).toBool(), true);
+
+    // still watched while active
+    Q_EMIT uplink.serviceStateChanged(NetworkService::FailureState);
+    QCOMPARE(machine.state(), TetheringStateMachine::Idle);
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(finished.takeFirst().at(0).toBool(), false);
+    QCOMPARE(machine.lastBringUp().value("success").toBool(), true);
+
+    machine.start(&wifi, &uplink);
+    Q_EMIT wifi.poweredChanged(true);
+    Q_EMIT wifi.tetheringChanged(true);
+    Q_EMIT uplink.serviceStateChanged(NetworkService::OnlineState);
+    QCOMPARE(machine.state(), TetheringStateMachine::Active);
+    finished.clear();
+    Q_EMIT wifi.tetheringChanged(false);
+    QCOMPARE(machine.state(), TetheringStateMachine::Idle);
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(finished.takeFirst().at(0).toBool(), false);
+}
+
+void Tst_connectionagent::tst_trafficSampler()
+{
+    TrafficSampler sampler;
+    QSignalSpy idle(&sampler, SIGNAL(idle(qint64,quint64)));
+
+    // without counters there is no traffic, so the idle report still comes
+    sampler.setInterface("tst_no_such_interface");
+    sampler.setIdleTimeout(1);
+    sampler.start();
+    QVERIFY(sampler.isRunning() || idle.count() == 1);
+    QTest::qSleep(5);
+    QMetaObject::invokeMethod(&sampler, "sample");
+    QCOMPARE(idle.count(), 1);
+    QVERIFY(!sampler.isRunning());
+    QCOMPARE(sampler.bytesTransferred(), quint64(0));
+
+    // turning the timeout off while running stops the idle report
+    sampler.setIdleTimeout(60 * 1000);
+    sampler.start();
+    QVERIFY(sampler.isRunning());
+    sampler.setIdleTimeout(0);
+    QVERIFY(!sampler.isRunning());
+    QMetaObject::invokeMethod(&sampler, "sample");
+    QCOMPARE(idle.count(), 1);
+
+    // and turning it on again resumes sampling, only while started
+    sampler.setIdleTimeout(60 * 1000);
+    QVERIFY(sampler.isRunning());
+    sampler.stop();
+    sampler.setIdleTimeout(0);
+    sampler.setIdleTimeout(60 * 1000);
+    QVERIFY(!sampler.isRunning());
+}
+
+void Tst_connectionagent::tst_uplinkCost()
+{
+    UplinkSelector::Stats unknown;
+    UplinkSelector::Stats fast;
+    fast.rtt = 40;
+    UplinkSelector::Stats slow;
+    slow.rtt = 400;
+    UplinkSelector::Stats failing = fast;
+    failing.failures = 2;
+    UplinkSelector::Stats busy = slow;
+    busy.throughput = 5000000;
+
+    // a measured, connected uplink beats an unmeasured one
+    QVERIFY(UplinkSelector::cost(fast, true) < UplinkSelector::cost(unknown, true));
+    // an uplink that first has to connect is penalised
+    QVERIFY(UplinkSelector::cost(slow, true) < UplinkSelector::cost(fast, false));
+    QVERIFY(UplinkSelector::cost(failing, true) > UplinkSelector::cost(slow, true));
+    // throughput credit is bounded
+    QVERIFY(UplinkSelector::cost(busy, true) < UplinkSelector::cost(slow, true));
+    QVERIFY(UplinkSelector::cost(busy, true) > UplinkSelector::cost(fast, true) - 300);
+}
+
+void Tst_connectionagent::tst_migrationScore()
+{
+    QCOMPARE(MigrationEngine::score(0, 2, 60, 0.5, 0.5), 50 + 30 + 15 + 15);
+    // a technology connman does not prefer gets no preference points
+    QCOMPARE(MigrationEngine::score(-1, 2, 60, 0.5, 0.5), 30 + 15 + 15);
+    QVERIFY(MigrationEngine::score(-1, 0, 90, 0.9, 0.9) > MigrationEngine::score(-1, 0, 40, 0.5, 0.5) + 15);
+
+    NetworkService weak("/net/connman/service/wifi_weak", serviceProperties("wifi", "online", 40));
+    NetworkService strong("/net/connman/service/wifi_strong", serviceProperties("wifi", "idle", 90));
+    NetworkService close("/net/connman/service/wifi_close", serviceProperties("wifi", "idle", 50));
+    NetworkService wired("/net/connman/service/ethernet_wired", serviceProperties("ethernet", "online", 0));
+    NetworkService cell("/net/connman/service/cellular_cell", serviceProperties("cellular", "online", 100));
+
+    MigrationEngine engine;
+    engine.setMargin(15);
+    engine.setDwellTime(0);
+    QSignalSpy migrate(&engine, SIGNAL(migrate(NetworkService*,NetworkService*)));
+
+    // within the margin there is no challenger
+    engine.evaluate(QVector<NetworkService *>() << &weak << &close, &weak);
+    engine.evaluate(QVector<NetworkService *>() << &weak << &close, &weak);
+    QCOMPARE(migrate.count(), 0);
+
+    // a clearly better one has to win twice, then the cooldown holds
+    engine.evaluate(QVector<NetworkService *>() << &weak << &strong, &weak);
+    QCOMPARE(migrate.count(), 0);
+    engine.evaluate(QVector<NetworkService *>() << &weak << &strong, &weak);
+    QCOMPARE(migrate.count(), 1);
+    engine.evaluate(QVector<NetworkService *>() << &weak << &strong, &weak);
+    QCOMPARE(migrate.count(), 1);
+
+    // wired is never given up, and cellular is not left for wifi unless
+    // connman prefers wifi
+    MigrationEngine other;
+    other.setDwellTime(0);
+    QSignalSpy otherMigrate(&other, SIGNAL(migrate(NetworkService*,NetworkService*)));
+    for (int i = 0; i < 2; ++i) {
+        other.evaluate(QVector<NetworkService *>() << &wired << &strong, &wired);
+        other.evaluate(QVector<NetworkService *>() << &cell << &strong, &cell);
+    }
+    QCOMPARE(otherMigrate.count(), 0);
+    other.setTechnologyPreference(QStringList() << "wifi" << "cellular");
+    other.evaluate(QVector<NetworkService *>() << &cell << &strong, &cell);
+    other.evaluate(QVector<NetworkService *>() << &cell << &strong, &cell);
+    QCOMPARE(otherMigrate.count(), 1);
+}
+
+void Tst_connectionagent::tst_historyBuckets()
+{
+    QCOMPARE(ServiceHistory::onlineTimeBucket(0), 0);
+    QCOMPARE(ServiceHistory::onlineTimeBucket(499), 0);
+    QCOMPARE(ServiceHistory::onlineTimeBucket(500), 1);
+    QCOMPARE(ServiceHistory::onlineTimeBucket(3000), 3);
+    QCOMPARE(ServiceHistory::onlineTimeBucket(31999), 6);
+    QCOMPARE(ServiceHistory::onlineTimeBucket(600000), ServiceHistory::OnlineTimeBuckets - 1);
+
+    QTemporaryDir dir;
+    ServiceHistory history(dir.path() + "/history");
+    history.load();
+    QCOMPARE(history.successRate("/net/connman/service/wifi_none"), qreal(-1));
+    QCOMPARE(history.medianOnlineTime("/net/connman/service/wifi_none"), qint64(-1));
+}
+
+void Tst_connectionagent::tst_connectRace()
+{
+    NetworkService a("/net/connman/service/wifi_a", serviceProperties("wifi", "idle", 60));
+    NetworkService b("/net/connman/service/wifi_b", serviceProperties("wifi", "idle", 50));
+    NetworkService c("/net/connman/service/wifi_c", serviceProperties("wifi", "idle", 40));
+    const QVector<NetworkService *> candidates = QVector<NetworkService *>() << &a << &b << &c;
+
+    ConnectRace race;
+    QSignalSpy finished(&race, SIGNAL(finished(NetworkService*,qint64)));
+
+    // one at a time, as for wifi: the stagger gives up on the previous attempt
+    race.start(candidates, 1);
+    Q_EMIT b.serviceStateChanged(NetworkService::ReadyState);
+    QVERIFY(race.isRunning());
+    QMetaObject::invokeMethod(&race, "launchNext");
+    Q_EMIT a.serviceStateChanged(NetworkService::ReadyState);
+    QVERIFY(race.isRunning());
+    Q_EMIT b.serviceStateChanged(NetworkService::ReadyState);
+    QVERIFY(!race.isRunning());
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(finished.takeFirst().at(0).value<NetworkService *>(), &b);
+
+    // two at a time, the first attempt keeps running after the stagger
+    race.start(candidates, 2);
+    QMetaObject::invokeMethod(&race, "launchNext");
+    Q_EMIT a.serviceStateChanged(NetworkService::OnlineState);
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(finished.takeFirst().at(0).value<NetworkService *>(), &a);
+
+    // a failure starts the next candidate at once, no winner when all fail
+    race.start(candidates.mid(0, 2), 1);
+    Q_EMIT a.serviceStateChanged(NetworkService::FailureState);
+    QVERIFY(race.isRunning());
+    Q_EMIT b.serviceStateChanged(NetworkService::FailureState);
+    QCOMPARE(finished.count(), 1);
+    QVERIFY(!finished.takeFirst().at(0).value<NetworkService *>());
+}
+
+void Tst_connectionagent::tst_scanPrediction()
+{
+    QTemporaryDir dir;
+    const QString wifi = QStringLiteral("/net/connman/service/wifi_home");
+    {
+        ScanPredictor predictor(dir.path() + "/cells.ini");
+        predictor.load();
+        QSignalSpy spy(&predictor, SIGNAL(scanSuggested()));
+
+        // unknown cell: most periodic scans are skipped
+        predictor.setCell("244-91-100-1");
+        int suppressed = 0;
+        for (int i = 0; i < 6; ++i)
+            suppressed += predictor.shouldSuppressScan() ? 1 : 0;
+        QCOMPARE(suppressed, 5);
+
+        predictor.learn(wifi);
+        QVERIFY(!predictor.shouldSuppressScan());
+
+        predictor.setCell("244-91-100-2");
+        QCOMPARE(spy.count(), 0);
+        predictor.setCell("244-91-100-1");
+        QCOMPARE(spy.count(), 1);
+        // a suggestion without a scan is not a prediction
+        QCOMPARE(predictor.statistics().value("Predictions").toUInt(), 0u);
+        predictor.setCell("244-91-100-2");
+        predictor.setCell("244-91-100-1");
+        predictor.scanIssued();
+        predictor.learn(wifi);
+        QCOMPARE(predictor.statistics().value("Predictions").toUInt(), 1u);
+        QCOMPARE(predictor.statistics().value("Precision").toReal(), 1.0);
+    }
+
+    // learned cells survive a restart
+    ScanPredictor predictor(dir.path() + "/cells.ini");
+    QVERIFY(predictor.networks("244-91-100-1").isEmpty());
+    predictor.load();
+    QCOMPARE(predictor.networks("244-91-100-1"), QStringList() << wifi);
+}
+
+void Tst_connectionagent::tst_handover()
+{
+    NetworkService wifi("/net/connman/service/wifi_home", serviceProperties("wifi", "ready", 70));
+    NetworkService cell("/net/connman/service/cellular_home", serviceProperties("cellular", "online", 80));
+
+    HandoverController handover;
+    handover.setDeadline(1000);
+
+    // not online within the deadline: cellular is kept, but only until the
+    // wifi gets online, e.g. after a portal login
+    handover.begin(&wifi, &cell);
+    QVERIFY(handover.isActive());
+    QMetaObject::invokeMethod(&handover, "deadlineExpired");
+    QVERIFY(handover.isActive());
+    QCOMPARE(handover.statistics().value("Late").toUInt(), 1u);
+    QCOMPARE(handover.statistics().value("Aborted").toUInt(), 0u);
+    Q_EMIT wifi.serviceStateChanged(NetworkService::OnlineState);
+    QMetaObject::invokeMethod(&handover, "settle");
+    QVERIFY(!handover.isActive());
+    QCOMPARE(handover.statistics().value("Handovers").toUInt(), 1u);
+
+    // wifi going away aborts, also past the deadline
+    handover.begin(&wifi, &cell);
+    Q_EMIT wifi.serviceStateChanged(NetworkService::FailureState);
+    QVERIFY(!handover.isActive());
+    handover.begin(&wifi, &cell);
+    QMetaObject::invokeMethod(&handover, "deadlineExpired");
+    Q_EMIT wifi.serviceStateChanged(NetworkService::IdleState);
+    QVERIFY(!handover.isActive());
+    QCOMPARE(handover.statistics().value("Aborted").toUInt(), 2u);
+    QCOMPARE(handover.statistics().value("Handovers").toUInt(), 1u);
+
+    // another wifi takes over
+    NetworkService office("/net/connman/service/wifi_office", serviceProperties("wifi", "ready", 70));
+    handover.begin(&wifi, &cell);
+    handover.begin(&office, &cell);
+    QCOMPARE(handover.statistics().value("Aborted").toUInt(), 3u);
+
+    // online wifi confirms, the handover completes once settled
+    Q_EMIT office.serviceStateChanged(NetworkService::OnlineState);
+    QVERIFY(handover.isActive());
+    QMetaObject::invokeMethod(&handover, "settle");
+    QVERIFY(!handover.isActive());
+    QCOMPARE(handover.statistics().value("Handovers").toUInt(), 2u);
+    QCOMPARE(handover.statistics().value("Aborted").toUInt(), 3u);
+}
+
+void Tst_connectionagent::tst_qualityScore()
+{
+    QualityProber::Result result;
+    QCOMPARE(QualityProber::quality(result), qreal(0.5));
+
+    result.samples = 3;
+    result.rtt = 40;
+    QCOMPARE(QualityProber::quality(result), qreal(1));
+
+    // slow and lossy links score lower, unreachable ones zero
+    result.rtt = 525;
+    QCOMPARE(QualityProber::quality(result), qreal(0.5));
+    result.loss = 0.5;
+    QCOMPARE(QualityProber::quality(result), qreal(0.25));
+    result.rtt = -1;
+    result.loss = 1;
+    QCOMPARE(QualityProber::quality(result), qreal(0));
+}
+
+void Tst_connectionagent::tst_portalCache()
+{
+    const QString path = QStringLiteral("/net/connman/service/wifi_cafe");
+    NetworkService wifi(path, serviceProperties("wifi", "ready", 70));
+    NetworkService other("/net/connman/service/wifi_other", serviceProperties("wifi", "ready", 70));
+
+    PortalCache cache;
+    cache.setValidity(60 * 1000);
+    QSignalSpy browser(&cache, SIGNAL(browserNeeded(QString,QString)));
+
+    // a first portal opens the browser, getting online afterwards is a login
+    cache.portalRequested(&wifi, "http://portal.example/login");
+    QCOMPARE(browser.count(), 1);
+    QVERIFY(!cache.isValid(path));
+    cache.recordState(&wifi, NetworkService::OnlineState);
+    QVERIFY(cache.isValid(path));
+    QCOMPARE(cache.statistics().value("ValidLogins").toInt(), 1);
+
+    // online without a portal is not a login
+    cache.recordState(&other, NetworkService::OnlineState);
+    QVERIFY(!cache.isValid(other.path()));
+
+    // a validity of 0 disables the cache
+    cache.setValidity(0);
+    QVERIFY(!cache.isValid(path));
+    cache.setValidity(60 * 1000);
+    QVERIFY(cache.isValid(path));
+
+    // logins of services that are gone are dropped
+    cache.retain(QStringList() << path);
+    QVERIFY(cache.isValid(path));
+    cache.retain(QStringList());
+    QVERIFY(!cache.isValid(path));
+}
+
+void Tst_connectionagent::tst_credentialProvider()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/credentials.ini";
+    const QString path = QStringLiteral("/net/connman/service/wifi_0011_6f6666696365_managed_ieee8021x");
+    {
+        QFile store(fileName);
+        QVERIFY(store.open(QIODevice::WriteOnly));
+        store.write("[" + CredentialProvider::identifier(path).toUtf8() + "]\n"
+                    "Identity = @user@example.com\n"
+                    "Passphrase = se,cr\"et\n");
+    }
+    QFile::setPermissions(fileName, QFile::ReadOwner | QFile::WriteOwner);
+
+    QVariantMap mandatory;
+    mandatory.insert("Requirement", "mandatory");
+    QVariantMap fields;
+    fields.insert("Identity", mandatory);
+    fields.insert("Passphrase", mandatory);
+
+    CredentialProvider provider(fileName);
+    QVariantMap reply;
+    QVERIFY(!provider.answer(path, fields, &reply));
+
+    provider.setEnabled(true);
+
+    // a field that is not provisioned goes to the dialog
+    fields.insert("Password", mandatory);
+    QVERIFY(!provider.answer(path, fields, &reply));
+    fields.remove("Password");
+
+    QVERIFY(provider.answer(path, fields, &reply));
+    QCOMPARE(reply.value("Identity").toString(), QString("@user@example.com"));
+    QCOMPARE(reply.value("Passphrase").toString(), QString("se,cr\"et"));
+
+    // asked again without getting up: the credentials are wrong
+    QVERIFY(!provider.answer(path, fields, &reply));
+    QVERIFY(!provider.answer(path, fields, &reply));
+    QCOMPARE(provider.statistics().value("Rejected").toInt(), 1);
+
+    const QString other = QStringLiteral("/net/connman/service/wifi_0022_6f6666696365_managed_ieee8021x");
+    {
+        QFile store(fileName);
+        QVERIFY(store.open(QIODevice::Append));
+        store.write("[" + CredentialProvider::identifier(other).toUtf8() + "]\n"
+                    "Identity = other\nPassphrase = other\n");
+    }
+    // the edited file gives every service another chance, a failure
+    // after answering rejects too
+    QVERIFY(provider.answer(path, fields, &reply));
+    NetworkService service(other, serviceProperties("wifi", "configuration", 60));
+    QVERIFY(provider.answer(other, fields, &reply));
+    provider.recordState(&service, NetworkService::FailureState);
+    QVERIFY(!provider.answer(other, fields, &reply));
+    QVERIFY(provider.answer(path, fields, &reply));
+
+    // a store others can read is not used
+    QFile::setPermissions(fileName, QFile::ReadOwner | QFile::WriteOwner | QFile::ReadOther);
+    QVERIFY(!provider.answer(path, fields, &reply));
+}
+
+void Tst_connectionagent::tst_retryScheduler()
+{
+    QCOMPARE(RetryScheduler::backoff(0, 1000, 8000), qint64(0));
+    QCOMPARE(RetryScheduler::backoff(1, 1000, 8000), qint64(1000));
+    QCOMPARE(RetryScheduler::backoff(3, 1000, 8000), qint64(4000));
+    QCOMPARE(RetryScheduler::backoff(10, 1000, 8000), qint64(8000));
+
+    const QString path = QStringLiteral("/net/connman/service/wifi_broken");
+    NetworkService wifi(path, serviceProperties("wifi", "failure", 70));
+
+    RetryScheduler scheduler;
+    scheduler.setBackoff(60 * 1000, 10 * 60 * 1000);
+    QSignalSpy due(&scheduler, SIGNAL(retryDue(QString)));
+
+    // each failure doubles the quarantine, give or take the jitter
+    scheduler.recordState(&wifi, NetworkService::FailureState);
+    QVERIFY(scheduler.isQuarantined(path));
+    qint64 retryIn = scheduler.toVariantMap().value(path).toMap().value("RetryIn").toLongLong();
+    QVERIFY(retryIn >= 45 * 1000 && retryIn <= 75 * 1000);
+    scheduler.recordState(&wifi, NetworkService::FailureState);
+    QVariantMap entry = scheduler.toVariantMap().value(path).toMap();
+    QCOMPARE(entry.value("Failures").toInt(), 2);
+    retryIn = entry.value("RetryIn").toLongLong();
+    QVERIFY(retryIn >= 90 * 1000 && retryIn <= 150 * 1000);
+
+    // the quarantine carries over a restart
+    RetryScheduler restored;
+    restored.restoreState(scheduler.saveState());
+    QVERIFY(restored.isQuarantined(path));
+    QCOMPARE(restored.toVariantMap().value(path).toMap().value("Failures").toInt(), 2);
+
+    // releasing keeps the history, nothing is due until the quarantine runs out
+    scheduler.release(path);
+    QVERIFY(!scheduler.isQuarantined(path));
+    QCOMPARE(scheduler.toVariantMap().value(path).toMap().value("Failures").toInt(), 2);
+    QMetaObject::invokeMethod(&scheduler, "expire");
+    QCOMPARE(due.count(), 0);
+
+    // a running out quarantine is announced once
+    scheduler.setBackoff(0, 0);
+    scheduler.recordState(&wifi, NetworkService::FailureState);
+    QVERIFY(!scheduler.isQuarantined(path));
+    QMetaObject::invokeMethod(&scheduler, "expire");
+    QMetaObject::invokeMethod(&scheduler, "expire");
+    QCOMPARE(due.count(), 1);
+    QCOMPARE(due.first().first().toString(), path);
+
+    // getting online forgets the failures
+    scheduler.recordState(&wifi, NetworkService::OnlineState);
+    QVERIFY(!scheduler.toVariantMap().contains(path));
+}
+
+void Tst_connectionagent::tst_ethernetPowerSave()
+{
+    NetworkService cellular("/net/connman/service/cellular_1", serviceProperties("cellular", "online", 60));
+    QVariantMap manualProperties = serviceProperties("cellular", "ready", 60);
+    manualProperties.insert("AutoConnect", false);
+    NetworkService manual("/net/connman/service/cellular_2", manualProperties);
+    const QVector<NetworkService *> services = QVector<NetworkService *>() << &cellular << &manual;
+
+    EthernetPowerSave powerSave;
+    QSignalSpy resumed(&powerSave, SIGNAL(resumed()));
+
+    // nothing happens until ethernet is online
+    powerSave.update(false, services);
+    QVERIFY(!powerSave.isActive());
+
+    // an autoconnecting cellular connection is parked, a manual one is not
+    powerSave.update(true, services);
+    QVERIFY(powerSave.isActive());
+    powerSave.scanSkipped();
+    QTest::qSleep(10);
+    powerSave.update(false, services);
+    QVERIFY(!powerSave.isActive());
+    QCOMPARE(resumed.count(), 1);
+    QVariantMap stats = powerSave.statistics();
+    QCOMPARE(stats.value("ScansSaved").toInt(), 1);
+    QVERIFY(stats.value("CellularParkedTime").toLongLong() > 0);
+
+    // with parking off only the wired time grows
+    powerSave.setParkCellular(false);
+    powerSave.update(true, services);
+    QTest::qSleep(10);
+    powerSave.update(false, services);
+    QCOMPARE(powerSave.statistics().value("CellularParkedTime"), stats.value("CellularParkedTime"));
+    QVERIFY(powerSave.statistics().value("WiredTime").toLongLong() > stats.value("WiredTime").toLongLong());
+
+    // disabling resumes right away and keeps it off
+    powerSave.update(true, services);
+    powerSave.setEnabled(false);
+    QVERIFY(!powerSave.isActive());
+    QCOMPARE(resumed.count(), 3);
+    powerSave.update(true, services);
+    QVERIFY(!powerSave.isActive());
+}
+
+void Tst_connectionagent::tst_sleepWatcher()
+{
+    SleepWatcher watcher;
+    QSignalSpy sleeping(&watcher, SIGNAL(aboutToSleep()));
+    QSignalSpy resumed(&watcher, SIGNAL(resumed()));
+
+    // online without a resume is not measured
+    watcher.online();
+    QCOMPARE(watcher.statistics().value("ResumesOnline").toInt(), 0);
+
+    QMetaObject::invokeMethod(&watcher, "prepareForSleep", Q_ARG(bool, true));
+    QCOMPARE(sleeping.count(), 1);
+    QVERIFY(!watcher.isResuming());
+
+    QMetaObject::invokeMethod(&watcher, "prepareForSleep", Q_ARG(bool, false));
+    QCOMPARE(resumed.count(), 1);
+    QVERIFY(watcher.isResuming());
+
+    // the first time online after resume is measured once
+    QTest::qSleep(10);
+    watcher.online();
+    QVERIFY(!watcher.isResuming());
+    watcher.online();
+    const QVariantMap stats = watcher.statistics();
+    QCOMPARE(stats.value("Suspends").toInt(), 1);
+    QCOMPARE(stats.value("ResumesOnline").toInt(), 1);
+    QVERIFY(stats.value("LastResumeToOnline").toLongLong() >= 10);
+    QCOMPARE(stats.value("MaxResumeToOnline"), stats.value("LastResumeToOnline"));
+    QCOMPARE(stats.value("AverageResumeToOnline"), stats.value("LastResumeToOnline"));
+
+    // going to sleep again drops a measurement still running
+    QMetaObject::invokeMethod(&watcher, "prepareForSleep", Q_ARG(bool, false));
+    QMetaObject::invokeMethod(&watcher, "prepareForSleep", Q_ARG(bool, true));
+    QVERIFY(!watcher.isResuming());
+    watcher.online();
+    QCOMPARE(watcher.statistics().value("ResumesOnline").toInt(), 1);
+}
+
+void Tst_connectionagent::tst_metrics()
+{
+    QCOMPARE(Metrics::bucket(0), 0);
+    QCOMPARE(Metrics::bucket(10), 0);
+    QCOMPARE(Metrics::bucket(11), 1);
+    QCOMPARE(Metrics::bucket(60000000), Metrics::BucketCount - 2);
+    QCOMPARE(Metrics::bucket(60000001), Metrics::BucketCount - 1);
+
+    Metrics metrics;
+    metrics.increment("update_services");
+    metrics.increment("update_services");
+    metrics.record("time_to_online.wifi", 1500000);
+    metrics.record("time_to_online.wifi", 400);
+    QCOMPARE(metrics.counter("update_services"), quint64(2));
+
+    const QVariantMap wifi = metrics.toVariantMap().value("Histograms").toMap()
+            .value("time_to_online.wifi").toMap();
+    QCOMPARE(wifi.value("Count").toULongLong(), quint64(2));
+    QCOMPARE(wifi.value("Max").toLongLong(), qint64(1500000));
+    QCOMPARE(wifi.value("Buckets").toList().at(Metrics::bucket(400)).toULongLong(), quint64(1));
+    QVERIFY(metrics.toText().contains("time_to_online.wifi count 2"));
+}
+
+void Tst_connectionagent::tst_eventJournal()
+{
+    const QString wifi = QStringLiteral("/net/connman/service/wifi_journal");
+    QCOMPARE(EventJournal::intern(wifi), EventJournal::intern(wifi));
+
+    EventJournal::request(EventJournal::Connect, wifi);
+    EventJournal::record(EventJournal::ServiceState, wifi, EventJournal::intern("online"));
+
+    bool ok = false;
+    const QStringList lines = EventJournal::decode(EventJournal::dump(), &ok);
+    QVERIFY(ok);
+    QVERIFY(lines.count() >= 2);
+    QVERIFY(lines.at(lines.count() - 2).contains("request"));
+    QVERIFY(lines.at(lines.count() - 2).endsWith(wifi + " connect"));
+    QVERIFY(lines.last().endsWith(wifi + " online"));
+
+    EventJournal::decode(QByteArray("garbage"), &ok);
+    QVERIFY(!ok);
+}
+
+void Tst_connectionagent::tst_tracing()
+{
+    // nothing is stored unless tracing is on or a watchdog looks
+    {
+        Tracing::Span span("tst_unwatched", "test");
+        QVERIFY(!Tracing::currentSpan()->load());
+    }
+
+    Tracing::setWatched(true);
+    {
+        Tracing::Span span("tst_disabled", "test");
+        {
+            Tracing::Span inner("tst_inner", "test");
+            QCOMPARE(Tracing::currentSpan()->load(), "tst_inner");
+        }
+        QCOMPARE(Tracing::currentSpan()->load(), "tst_disabled");
+    }
+    Tracing::setWatched(false);
+    QVERIFY(!Tracing::currentSpan()->load());
+    QVERIFY(!Tracing::toJson().contains("tst_disabled"));
+
+    Tracing::setEnabled(true);
+    {
+        Tracing::Span span("tst_enabled", "test");
+    }
+    Tracing::setEnabled(false);
+
+    const QJsonDocument trace = QJsonDocument::fromJson(Tracing::toJson());
+    QVERIFY(trace.isObject());
+    const QJsonArray events = trace.object().value("traceEvents").toArray();
+    QCOMPARE(events.count(), 2);
+    QCOMPARE(events.at(0).toObject().value("ph").toString(), QString("B"));
+    QCOMPARE(events.at(1).toObject().value("ph").toString(), QString("E"));
+    QCOMPARE(events.at(1).toObject().value("name").toString(), QString("tst_enabled"));
+}
+
+void Tst_connectionagent::tst_startupTimings()
+{
+    StartupTimings *timings = StartupTimings::instance();
+    {
+        StartupTimings::Phase outer("tst_outer");
+        StartupTimings::Phase inner("tst_inner");
+    }
+    timings->begin("tst_open");
+
+    QHash<QString, qint64> durations;
+    for (const QVariant &phase : timings->toVariantMap().value("Phases").toList()) {
+        const QVariantMap entry = phase.toMap();
+        durations.insert(entry.value("Name").toString(), entry.value("Duration").toLongLong());
+    }
+    // the agent registered itself on construction
+    QVERIFY(durations.contains("agent"));
+    QVERIFY(durations.value("tst_outer") >= durations.value("tst_inner"));
+    QVERIFY(durations.value("tst_inner") >= 0);
+    QCOMPARE(durations.value("tst_open"), qint64(-1));
+    // connman is only looked up, and the disk only read, once the event loop runs
+    QVERIFY(!durations.contains("config"));
+    QVERIFY(!durations.contains("history"));
+    QVERIFY(!timings->isReady());
+    timings->end("tst_open");
+
+    // the age of a boosted process is the booster's, not the launch's
+    timings->setBoosted(true);
+    QCOMPARE(timings->toVariantMap().value("BeforeMain").toLongLong(), qint64(-1));
+    timings->setBoosted(false);
+}
+
+void Tst_connectionagent::tst_warmSnapshot()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/snapshot";
+
+    WarmSnapshot saved;
+    WarmSnapshot::Service service = { QStringLiteral("/net/connman/service/wifi_1"), true };
+    saved.services << service;
+    saved.wifiTethering = true;
+    saved.tetheringUplink = QStringLiteral("/net/connman/service/cellular_1");
+    saved.scanDeadline = 1234;
+    saved.retryState = QByteArray("retry");
+    QVERIFY(saved.save(fileName));
+
+    WarmSnapshot loaded;
+    QVERIFY(loaded.take(fileName, 60 * 1000));
+    QVERIFY(loaded.isValid());
+    QCOMPARE(loaded.services.count(), 1);
+    QCOMPARE(loaded.services.at(0).path, service.path);
+    QVERIFY(loaded.services.at(0).autoConnect);
+    QVERIFY(loaded.wifiTethering);
+    QCOMPARE(loaded.tetheringUplink, saved.tetheringUplink);
+    QCOMPARE(loaded.scanDeadline, qint64(1234));
+    QCOMPARE(loaded.retryState, saved.retryState);
+
+    // a snapshot is used once
+    WarmSnapshot again;
+    QVERIFY(!again.take(fileName, 60 * 1000));
+    QVERIFY(!again.isValid());
+
+    // and not when too old
+    QVERIFY(saved.save(fileName));
+    QTest::qSleep(10);
+    QVERIFY(!again.take(fileName, 1));
+}
+
+void Tst_connectionagent::tst_agentConfig()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.path() + "/connectionagent.conf";
+    const QString group = QStringLiteral("tst_agentConfig");
+    {
+        AgentConfig config(group, fileName);
+        config.load();
+        config.setValue("a", 1);
+        config.setValue("b", true);
+        QCOMPARE(config.value("a").toInt(), 1);
+        // written behind, not on every change
+        QCOMPARE(config.writes(), quint32(0));
+        config.flush();
+        QCOMPARE(config.writes(), quint32(1));
+
+        config.remove("a");
+        QVERIFY(!config.contains("a"));
+    }
+
+    // the rest is written when the config goes away
+    AgentConfig reloaded(group, fileName);
+    QVERIFY(!reloaded.contains("b"));
+    reloaded.load();
+    QVERIFY(!reloaded.contains("a"));
+    QCOMPARE(reloaded.value("b").toBool(), true);
+    QCOMPARE(reloaded.value("c", 3).toInt(), 3);
+
+    // edits by others are picked up, unwritten changes here still stand
+    {
+        QSettings settings(fileName, QSettings::IniFormat);
+        settings.setValue(group + "/c", 4);
+    }
+    reloaded.setValue("d", 5);
+    QVERIFY(reloaded.reload());
+    QCOMPARE(reloaded.value("c").toInt(), 4);
+    QCOMPARE(reloaded.value("d").toInt(), 5);
+    reloaded.flush();
+    QVERIFY(!reloaded.reload());
+    QCOMPARE(reloaded.value("d").toInt(), 5);
+}
+
+void Tst_connectionagent::tst_connmanConfig()
+{
+    const QByteArray mainConf =
+            "# connman main.conf\n"
+            "[General]\n"
+            "DefaultAutoConnectTechnologies = wifi,cellular\n"
+            "PreferredTechnologies=ethernet, wifi\n"
+            "  AlwaysConnectedTechnologies =cellular\n"
+            "; SingleConnectedTechnology = true\n"
+            "[Other]\n"
+            "DefaultAutoConnectTechnologies = bluetooth\n";
+
+    const QHash<QString, QString> values = ConnmanConfig::parse(mainConf);
+    QCOMPARE(values.value("General/DefaultAutoConnectTechnologies"), QString("wifi,cellular"));
+    QCOMPARE(values.value("Other/DefaultAutoConnectTechnologies"), QString("bluetooth"));
+    QVERIFY(!values.contains("General/SingleConnectedTechnology"));
+    QCOMPARE(ConnmanConfig::toList(values.value("General/PreferredTechnologies")),
+             QStringList() << "ethernet" << "wifi");
+
+    QTemporaryDir dir;
+    QFile file(dir.path() + "/main.conf");
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(mainConf);
+    file.close();
+
+    ConnmanConfig config(file.fileName());
+    QVERIFY(config.load());
+    QCOMPARE(config.defaultAutoConnectTechnologies(), QStringList() << "wifi" << "cellular");
+    QCOMPARE(config.alwaysConnectedTechnologies(), QStringList() << "cellular");
+}
+
+void Tst_connectionagent::tst_idleReclaimer()
+{
+    QVERIFY(IdleReclaimer::residentSize() > 0);
+
+    IdleReclaimer reclaimer;
+    QSignalSpy active(&reclaimer, SIGNAL(active()));
+    reclaimer.activity();
+    QVERIFY(!reclaimer.isIdle());
+    QCOMPARE(active.count(), 0);
+
+    reclaimer.enterIdle();
+    QVERIFY(reclaimer.isIdle());
+    reclaimer.activity();
+    QVERIFY(!reclaimer.isIdle());
+    QCOMPARE(active.count(), 1);
+
+    reclaimer.reclaimed("idle", 4000, 3000);
+    reclaimer.reclaimed("pressure", 3000, 3500);
+    const QVariantMap stats = reclaimer.statistics();
+    QCOMPARE(stats.value("Reclaims").toUInt(), 2u);
+    QCOMPARE(stats.value("LastReason").toString(), QString("pressure"));
+    QCOMPARE(stats.value("Freed").toLongLong(), qint64(1000));
+
+    QVERIFY(!reclaimer.watchPressure("/nonexistent/pressure/memory"));
 }
 
 QTEST_APPLESS_MAIN(Tst_connectionagent)
@@ -1,4 +1,4 @@
-QT       += testlib dbus
+QT       += testlib dbus network
 QT       -= gui
 
 TARGET = tst_connectionagent
@@ -11,9 +11,61 @@ DEFINES += SRCDIR=\\\"$$PWD/\\\"
 
 SOURCES += tst_connectionagent.cpp \
         ../../../connd/qconnectionagent.cpp \
+        ../../../connd/tetheringstatemachine.cpp \
+        ../../../connd/trafficsampler.cpp \
+        ../../../connd/uplinkselector.cpp \
+        ../../../connd/migrationengine.cpp \
+        ../../../connd/servicehistory.cpp \
+        ../../../connd/connectrace.cpp \
+        ../../../connd/celllocator.cpp \
+        ../../../connd/scanpredictor.cpp \
+        ../../../connd/handovercontroller.cpp \
+        ../../../connd/qualityprober.cpp \
+        ../../../connd/portalcache.cpp \
+        ../../../connd/credentialprovider.cpp \
+        ../../../connd/retryscheduler.cpp \
+        ../../../connd/ethernetpowersave.cpp \
+        ../../../connd/sleepwatcher.cpp \
+        ../../../connd/metrics.cpp \
+        ../../../connd/eventjournal.cpp \
+        ../../../connd/tracing.cpp \
+        ../../../connd/unixsignalnotifier.cpp \
+        ../../../connd/logsink.cpp \
+        ../../../connd/lagmonitor.cpp \
+        ../../../connd/startuptimings.cpp \
+        ../../../connd/warmsnapshot.cpp \
+        ../../../connd/agentconfig.cpp \
+        ../../../connd/connmanconfig.cpp \
+        ../../../connd/idlereclaimer.cpp \
         ../../../connd/connectiond_adaptor.cpp
 HEADERS += \
         ../../../connd/qconnectionagent.h \
+        ../../../connd/tetheringstatemachine.h \
+        ../../../connd/trafficsampler.h \
+        ../../../connd/uplinkselector.h \
+        ../../../connd/migrationengine.h \
+        ../../../connd/servicehistory.h \
+        ../../../connd/connectrace.h \
+        ../../../connd/celllocator.h \
+        ../../../connd/scanpredictor.h \
+        ../../../connd/handovercontroller.h \
+        ../../../connd/qualityprober.h \
+        ../../../connd/portalcache.h \
+        ../../../connd/credentialprovider.h \
+        ../../../connd/retryscheduler.h \
+        ../../../connd/ethernetpowersave.h \
+        ../../../connd/sleepwatcher.h \
+        ../../../connd/metrics.h \
+        ../../../connd/eventjournal.h \
+        ../../../connd/tracing.h \
+        ../../../connd/unixsignalnotifier.h \
+        ../../../connd/logsink.h \
+        ../../../connd/lagmonitor.h \
+        ../../../connd/startuptimings.h \
+        ../../../connd/warmsnapshot.h \
+        ../../../connd/agentconfig.h \
+        ../../../connd/connmanconfig.h \
+        ../../../connd/idlereclaimer.h \
         ../../../connd/connectiond_adaptor.h
 
 INCLUDEPATH += $$OUT_PWD/../../../connd
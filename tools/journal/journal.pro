@@ -0,0 +1,18 @@
+QT = core dbus
+
+TARGET = connectionagent-journal
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+INCLUDEPATH += ../../connd
+
+SOURCES += main.cpp \
+    ../../connd/eventjournal.cpp
+
+HEADERS += \
+    ../../connd/eventjournal.h
+
+target.path = /usr/bin
+INSTALLS += target
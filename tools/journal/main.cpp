@@ -0,0 +1,78 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include <QtCore/QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QFile>
+#include <QTextStream>
+
+#include "eventjournal.h"
+
+// Prints the agent's event journal, either fetched from the running agent
+// or from a file saved earlier with --raw.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments().mid(1);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    const bool raw = args.removeAll(QStringLiteral("--raw")) > 0;
+    if (args.count() > 1 || args.contains(QStringLiteral("--help"))) {
+        err << "Usage: connectionagent-journal [--raw] [file]\n"
+            << "Decodes the connectionagent event journal from file, or from the running agent.\n"
+            << "--raw writes the undecoded journal to stdout.\n";
+        return 1;
+    }
+
+    QByteArray journal;
+    if (args.isEmpty()) {
+        QDBusMessage call = QDBusMessage::createMethodCall(QStringLiteral("com.jolla.Connectiond"),
+                                                           QStringLiteral("/Connectiond"),
+                                                           QStringLiteral("com.jolla.Connectiond"),
+                                                           QStringLiteral("DumpJournal"));
+        QDBusMessage reply = QDBusConnection::sessionBus().call(call);
+        if (reply.type() != QDBusMessage::ReplyMessage) {
+            err << "Cannot get the journal: " << reply.errorMessage() << '\n';
+            return 1;
+        }
+        journal = reply.arguments().value(0).toByteArray();
+    } else {
+        QFile file(args.first());
+        if (!file.open(QIODevice::ReadOnly)) {
+            err << "Cannot open " << args.first() << '\n';
+            return 1;
+        }
+        journal = file.readAll();
+    }
+
+    if (raw) {
+        QFile stdoutFile;
+        stdoutFile.open(stdout, QIODevice::WriteOnly);
+        stdoutFile.write(journal);
+        return 0;
+    }
+
+    bool ok = false;
+    const QStringList lines = EventJournal::decode(journal, &ok);
+    for (const QString &line : lines)
+        out << line << '\n';
+    if (!ok) {
+        err << "Journal is not valid or truncated\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+/****************************************************************************
+**
+** Copyright (C) 2026 Jolla Ltd
+** Contact: lorn.potter@gmail.com
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+
+#include <QtCore/QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDBusServiceWatcher>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QProcess>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <QVariantMap>
+
+#include <algorithm>
+
+static const char *Service = "com.jolla.Connectiond";
+static const int Timeout = 10 * 1000;
+// the agent times itself, so it is asked rarely to stay out of its way
+static const int PollInterval = 100;
+
+struct Run {
+    qint64 registered;  // until the D-Bus name is claimed
+    qint64 ready;       // until setup() is done
+    qint64 beforeMain;  // -1 when boosted
+};
+
+static bool registered(QDBusConnection &bus)
+{
+    return bus.interface()->isServiceRegistered(QString::fromLatin1(Service));
+}
+
+static QVariantMap startupTimings(QDBusConnection &bus)
+{
+    QDBusMessage call = QDBusMessage::createMethodCall(QString::fromLatin1(Service),
+                                                       QStringLiteral("/Connectiond"),
+                                                       QStringLiteral("com.jolla.Connectiond"),
+                                                       QStringLiteral("startupTimings"));
+    return bus.call(call).arguments().value(0).toMap();
+}
+
+// Agent clock time at which the D-Bus name was claimed
+static qint64 registeredAt(const QVariantMap &timings)
+{
+    for (const QVariant &phase : timings.value(QStringLiteral("Phases")).toList()) {
+        const QVariantMap entry = phase.toMap();
+        if (entry.value(QStringLiteral("Name")).toString() == QLatin1String("dbus"))
+            return entry.value(QStringLiteral("Start")).toLongLong() + entry.value(QStringLiteral("Duration")).toLongLong();
+    }
+    return -1;
+}
+
+static bool measure(const QString &program, const QStringList &arguments, Run *run)
+{
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    QDBusServiceWatcher watcher(QString::fromLatin1(Service), bus, QDBusServiceWatcher::WatchForRegistration);
+    QEventLoop loop;
+    QTimer::singleShot(Timeout, &loop, &QEventLoop::quit);
+
+    run->registered = -1;
+    run->ready = -1;
+    run->beforeMain = -1;
+
+    QProcess process;
+    QElapsedTimer clock;
+    QObject::connect(&watcher, &QDBusServiceWatcher::serviceRegistered, [&]() {
+        run->registered = clock.elapsed();
+        loop.quit();
+    });
+    clock.start();
+    process.start(program, arguments);
+    loop.exec();
+
+    // ready is the registration seen here plus the agent's own time from
+    // claiming the name to ready
+    while (run->registered >= 0 && clock.elapsed() < Timeout) {
+        QThread::msleep(PollInterval);
+        const QVariantMap timings = startupTimings(bus);
+        const qint64 ready = timings.value(QStringLiteral("Ready"), -1).toLongLong();
+        const qint64 claimed = registeredAt(timings);
+        if (ready >= 0 && claimed >= 0) {
+            run->ready = run->registered + ready - claimed;
+            run->beforeMain = timings.value(QStringLiteral("BeforeMain"), -1).toLongLong();
+            break;
+        }
+    }
+
+    // invoker passes the signal on to the agent
+    process.terminate();
+    if (!process.waitForFinished(Timeout))
+        process.kill();
+    QElapsedTimer gone;
+    gone.start();
+    while (registered(bus) && gone.elapsed() < Timeout)
+        QThread::msleep(10);
+    return run->ready >= 0;
+}
+
+static qint64 median(QVector<qint64> values)
+{
+    std::sort(values.begin(), values.end());
+    return values.isEmpty() ? -1 : values.at(values.count() / 2);
+}
+
+static QString column(qint64 value)
+{
+    return value < 0 ? QStringLiteral("-") : QString::number(value);
+}
+
+// Starts the agent repeatedly, plain and through the booster, and compares
+// the time until it has claimed its D-Bus name and until it is ready.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments().mid(1);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    int runs = 10;
+    const int countIndex = args.indexOf(QStringLiteral("-n"));
+    if (countIndex >= 0 && countIndex + 1 < args.count())
+        runs = qMax(1, args.at(countIndex + 1).toInt());
+    if (args.contains(QStringLiteral("--help"))) {
+        err << "Usage: connectionagent-startupbench [-n runs]\n"
+            << "Compares plain and boosted startup of connectionagent. Stop the running agent first:\n"
+            << "  systemctl --user stop connectionagent\n";
+        return 1;
+    }
+
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (registered(bus)) {
+        err << "connectionagent is already running, stop it first\n";
+        return 1;
+    }
+
+    struct Mode {
+        const char *name;
+        QString program;
+        QStringList arguments;
+    };
+    const Mode modes[] = {
+        { "plain", QStringLiteral("/usr/bin/connectionagent"), QStringList() },
+        { "boosted", QStringLiteral("/usr/bin/invoker"),
+          QStringList() << QStringLiteral("--type=qt5") << QStringLiteral("/usr/bin/connectionagent") },
+    };
+
+    out << "mode     runs  registered  ready  before main (median ms)\n";
+    for (const Mode &mode : modes) {
+        QVector<qint64> registeredTimes, readyTimes, beforeMainTimes;
+        for (int i = 0; i < runs; ++i) {
+            if (registered(bus)) {
+                err << "connectionagent did not exit within " << Timeout << " ms, giving up\n";
+                return 1;
+            }
+            Run run;
+            if (!measure(mode.program, mode.arguments, &run)) {
+                err << mode.name << ": agent not ready within " << Timeout << " ms\n";
+                continue;
+            }
+            registeredTimes << run.registered;
+            readyTimes << run.ready;
+            // a boosted process does not know when it was launched
+            if (run.beforeMain >= 0)
+                beforeMainTimes << run.beforeMain;
+        }
+        out << QString::fromLatin1(mode.name).leftJustified(9)
+            << QString::number(readyTimes.count()).leftJustified(6)
+            << column(median(registeredTimes)).leftJustified(12)
+            << column(median(readyTimes)).leftJustified(7)
+            << column(median(beforeMainTimes)) << '\n';
+    }
+    return 0;
+}
@@ -0,0 +1,12 @@
+QT = core dbus
+
+TARGET = connectionagent-startupbench
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += main.cpp
+
+target.path = /usr/bin
+INSTALLS += target